@@ -12,117 +12,209 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
 #include "common/macros.h"
+#include "common/numa.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type, int numa_node)
     : pool_size_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
       next_page_id_(instance_index),
+      numa_node_(numa_node),
       disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager),
+      replacer_(ReplacerFactory::CreateReplacer(replacer_type, pool_size)),
+      loading_(pool_size),
+      load_failed_(pool_size),
+      num_frames_(pool_size),
+      prefetcher_(std::make_unique<Prefetcher>(this, pool_size)) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
-  // We allocate a consecutive memory space for the buffer pool.
+  // We allocate a consecutive memory space for the buffer pool. The page data lives in a separate anonymous mapping,
+  // so that every frame is aligned for direct I/O and the kernel can back large pools with huge pages.
   pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+  frame_data_size_ = pool_size_ * PAGE_SIZE;
+  if (frame_data_size_ > 0) {
+    void *frame_data =
+        mmap(nullptr, frame_data_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (frame_data == MAP_FAILED) {
+      delete[] pages_;
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "can't allocate buffer pool frames");
+    }
+    // Nothing has touched the frames yet, so the binding decides where every one of them is placed.
+    if (numa_node_ >= 0 && !NumaUtil::BindToNode(frame_data, frame_data_size_, numa_node_)) {
+      LOG_WARN("can't bind buffer pool frames to NUMA node %d", numa_node_);
+    }
+    if (frame_data_size_ >= HUGE_PAGE_SIZE) {
+      // Only a hint: without transparent huge pages the frames are simply backed by base pages.
+      madvise(frame_data, frame_data_size_, MADV_HUGEPAGE);
+    }
+    frame_data_ = static_cast<char *>(frame_data);
+  }
 
-  // Initially, every page is in the free list.
+  // Initially, every page is in the free list. Fresh anonymous memory reads as zeros, so no frame needs resetting.
   for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].data_ = frame_data_ + i * PAGE_SIZE;
     free_list_.emplace_back(static_cast<int>(i));
   }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
+  // The prefetch thread fetches through this instance, so it has to be gone before the frames are.
+  prefetcher_.reset();
+  StopBackgroundWriter();
   delete[] pages_;
-  delete replacer_;
+  if (frame_data_ != nullptr) {
+    munmap(frame_data_, frame_data_size_);
+  }
 }
 
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
   // Make sure you call DiskManager::WritePage!
-  latch_.lock();
-  for(size_t i = 0; i < pool_size_; i++) {
-    if(pages_[i].GetPageId()==page_id) {
-      disk_manager_->WritePage(page_id, pages_[i].GetData());
-      pages_[i].is_dirty_ = false;
-      latch_.unlock();
-      return true;
-    }
+  LatencyHistogram::ScopedTimer timer(track_latency_ ? &counters_.flush_latency_ : nullptr);
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.RLock();
+  auto iter = partition.table_.find(page_id);
+  if (iter == partition.table_.end()) {
+    partition.latch_.RUnlock();
+    return false;
+  }
+  // A page that is still being read in is identical to its disk copy.
+  if (loading_[iter->second]) {
+    partition.latch_.RUnlock();
+    return true;
   }
-  latch_.unlock();
-  return false;
+  // The pin keeps the frame from being evicted while it is written out. The page latch is only taken once the
+  // partition latch is released, since a thread holding the page latch may be waiting for the partition latch.
+  Page *page = &pages_[iter->second];
+  page->pin_count_++;
+  partition.latch_.RUnlock();
+
+  page->RLatch();
+  WritePageToDisk(page);
+  page->RUnlatch();
+  counters_.flush_writes_.fetch_add(1, std::memory_order_relaxed);
+  UnpinAfterWriteBack(page);
+  return true;
 }
 
-void BufferPoolManagerInstance::FlushAllPgsImp() {
-  // You can do it!
-  latch_.lock();
-  for(size_t i = 0; i < pool_size_; i++) {
-    if(pages_[i].GetPageId()!=INVALID_PAGE_ID) {
-      disk_manager_->WritePage(pages_[i].GetPageId(), pages_[i].GetData());
-      pages_[i].is_dirty_ = false;
+void BufferPoolManagerInstance::FlushAllPgsImp() { FlushDirtyPages({this}); }
+
+void BufferPoolManagerInstance::FlushDirtyPages(const std::vector<BufferPoolManagerInstance *> &instances) {
+  // Collect the dirty pages without any latch. The snapshot may be stale; every page is checked again when it is
+  // pinned for its write.
+  std::vector<std::pair<page_id_t, BufferPoolManagerInstance *>> dirty_pages;
+  for (BufferPoolManagerInstance *instance : instances) {
+    for (size_t i = 0; i < instance->pool_size_; i++) {
+      page_id_t page_id = instance->pages_[i].page_id_;
+      if (page_id != INVALID_PAGE_ID && instance->pages_[i].is_dirty_) {
+        dirty_pages.emplace_back(page_id, instance);
+      }
+    }
+  }
+  std::sort(dirty_pages.begin(), dirty_pages.end());
+
+  // Write the pages in batches, so that only a bounded number of frames is pinned at any time. Every page is copied
+  // under its read latch, so that a writer cannot change it while it is on its way to disk, and the write itself
+  // holds no page latch.
+  std::vector<std::pair<BufferPoolManagerInstance *, Page *>> pinned_pages;
+  std::vector<DiskManager::DiskRequest> requests;
+  std::vector<char> batch_data(dirty_pages.empty() ? 0 : FLUSH_BATCH_SIZE * PAGE_SIZE);
+  for (size_t begin = 0; begin < dirty_pages.size(); begin += FLUSH_BATCH_SIZE) {
+    size_t end = std::min(begin + FLUSH_BATCH_SIZE, dirty_pages.size());
+    pinned_pages.clear();
+    requests.clear();
+    lsn_t max_lsn = INVALID_LSN;
+    for (size_t i = begin; i < end; i++) {
+      auto [page_id, instance] = dirty_pages[i];
+      Page *page = instance->PinForWriteBack(page_id);
+      if (page == nullptr) {
+        continue;
+      }
+      pinned_pages.emplace_back(instance, page);
+      char *page_copy = &batch_data[requests.size() * PAGE_SIZE];
+      page->RLatch();
+      max_lsn = std::max(max_lsn, page->GetLSN());
+      // Clear the flag first so that a concurrent UnpinPage(page_id, true) is not lost.
+      page->is_dirty_ = false;
+      memcpy(page_copy, page->GetData(), PAGE_SIZE);
+      page->RUnlatch();
+      requests.push_back({true, page_id, page_copy});
+    }
+    if (requests.empty()) {
+      continue;
+    }
+
+    // One log force covers the whole batch. Every instance of a parallel BPM shares the same log and disk manager.
+    LogManager *log_manager = instances.front()->log_manager_;
+    if (enable_logging && log_manager != nullptr && max_lsn > log_manager->GetPersistentLSN()) {
+      log_manager->Flush(true);
+    }
+    instances.front()->disk_manager_->SubmitRequests(&requests);
+
+    for (auto [instance, page] : pinned_pages) {
+      instance->counters_.flush_writes_.fetch_add(1, std::memory_order_relaxed);
+      instance->UnpinAfterWriteBack(page);
     }
   }
-  latch_.unlock();
 }
 
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
+  return TryNewPage(page_id, frame_wait_timeout_);
+}
+
+auto BufferPoolManagerInstance::TryNewPage(page_id_t *page_id, std::chrono::milliseconds frame_wait_timeout)
+    -> Page * {
   // 0.   Make sure you call AllocatePage!
-  // 1.   If all the pages in the buffer pool are pinned, return nullptr.
+  // 1.   If all the pages in the buffer pool are pinned, wait for a frame until the timeout, then return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
+  LatencyHistogram::ScopedTimer timer(track_latency_ ? &counters_.new_page_latency_ : nullptr);
+  auto latch = LockLatch();
 
-  latch_.lock();
-
-  frame_id_t replace_frame_id = -1;
-  if(!free_list_.empty()) {
-    replace_frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else {
-    bool success = replacer_->Victim(&replace_frame_id);
-    if(!success) {
-      latch_.unlock();
-      return nullptr;
-    } else {
-      page_table_.erase(pages_[replace_frame_id].GetPageId());
-    }
+  frame_id_t frame_id = -1;
+  if (!AcquireFrameOrWait(&latch, &frame_id, frame_wait_timeout, INVALID_PAGE_ID)) {
+    return nullptr;
   }
 
   *page_id = AllocatePage();
-  if(*page_id == INVALID_PAGE_ID){
-    latch_.unlock();
-    return nullptr;
-  }
-  
-  Page *replace_page = &pages_[replace_frame_id];
-  
-  if(replace_page->IsDirty()) {
-    disk_manager_->WritePage(replace_page->GetPageId(), replace_page->GetData());
-    if (enable_logging && replace_page->GetLSN() > log_manager_->GetPersistentLSN()) {
-      log_manager_->Flush(true);
-    }  
-  }
-  
-  replace_page->ResetMemory();
-  replace_page->pin_count_ = 1;
-  replace_page->is_dirty_ = true;
-  replace_page->page_id_ = *page_id;
+  Page *page = &pages_[frame_id];
+  page->ResetMemory();
+  page->page_id_ = *page_id;
+  page->pin_count_ = 1;
+  page->is_dirty_ = true;
 
-  page_table_[*page_id] = replace_frame_id;
-  latch_.unlock();
-  return replace_page;
+  auto &partition = GetPageTablePartition(*page_id);
+  partition.latch_.WLock();
+  partition.table_[*page_id] = frame_id;
+  partition.latch_.WUnlock();
+  counters_.new_pages_.fetch_add(1, std::memory_order_relaxed);
+  return page;
 }
 
-auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
+auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * { return TryFetchPage(page_id, true); }
+
+auto BufferPoolManagerInstance::TryFetchPage(page_id_t page_id, bool referenced) -> Page * {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
@@ -130,47 +222,83 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  latch_.lock();
-  if(page_table_.find(page_id)!=page_table_.end()) {
-    latch_.unlock();
-    auto page = &pages_[page_table_[page_id]];
-    page->pin_count_++;
-    replacer_->Pin(page_table_[page_id]);
+  LatencyHistogram::ScopedTimer timer(track_latency_ ? &counters_.fetch_latency_ : nullptr);
+  Page *page = PinResidentPage(page_id, referenced);
+  if (page != nullptr) {
+    counters_.hits_.fetch_add(1, std::memory_order_relaxed);
+    if (!WaitUntilLoaded(static_cast<frame_id_t>(page - pages_))) {
+      ReleaseFailedFrame(page);
+      return nullptr;
+    }
     return page;
   }
 
-  frame_id_t replace_frame_id = -1;
-  if(!free_list_.empty()) {
-    replace_frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else {
-    bool success = replacer_->Victim(&replace_frame_id);
-    if(!success) {
-      latch_.unlock();
+  auto latch = LockLatch();
+  // Another thread may have read the page in (or started to) while we were waiting for latch_.
+  page = PinResidentPage(page_id, referenced);
+  if (page != nullptr) {
+    latch.unlock();
+    counters_.hits_.fetch_add(1, std::memory_order_relaxed);
+    if (!WaitUntilLoaded(static_cast<frame_id_t>(page - pages_))) {
+      ReleaseFailedFrame(page);
       return nullptr;
-    } else {
-      page_table_.erase(pages_[replace_frame_id].GetPageId());
     }
+    return page;
+  }
+  // A deleted page must not be read back in: NewPage would hand out its id again while it is in the page table.
+  // Pages are deleted and allocated under latch_, so the check cannot race with either. It reads the free page bitmap
+  // without a latch, so misses of different instances do not serialize on it.
+  if (disk_manager_->IsPageFree(page_id)) {
+    return nullptr;
   }
 
-  Page *replace_page = &pages_[replace_frame_id];
-  
-
-  if(replace_page->IsDirty()&&replace_page->GetPageId()!=INVALID_PAGE_ID) {
-    disk_manager_->WritePage(replace_page->GetPageId(), replace_page->GetData());
-    if (enable_logging && replace_page->GetLSN() > log_manager_->GetPersistentLSN()) {
-      log_manager_->Flush(true);
+  frame_id_t frame_id = -1;
+  if (!AcquireFrameOrWait(&latch, &frame_id, frame_wait_timeout_, page_id)) {
+    // Another thread may have read the page in while we waited for a frame.
+    page = PinResidentPage(page_id, referenced);
+    if (page == nullptr) {
+      return nullptr;
+    }
+    latch.unlock();
+    counters_.hits_.fetch_add(1, std::memory_order_relaxed);
+    if (!WaitUntilLoaded(static_cast<frame_id_t>(page - pages_))) {
+      ReleaseFailedFrame(page);
+      return nullptr;
     }
+    return page;
   }
 
-  disk_manager_->ReadPage(page_id, replace_page->GetData());
-  replace_page->pin_count_ = 1;
-  replace_page->is_dirty_ = false;
-  replace_page->page_id_ = page_id;
+  // Publish the frame before reading into it, so that latch_ is not held across the read and misses on other pages
+  // proceed in parallel. Threads that find the page meanwhile wait in WaitUntilLoaded until the read is done.
+  page = &pages_[frame_id];
+  page->page_id_ = page_id;
+  page->pin_count_ = 1;
+  page->is_dirty_ = false;
+  loading_[frame_id] = true;
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.WLock();
+  partition.table_[page_id] = frame_id;
+  partition.latch_.WUnlock();
+  latch.unlock();
 
-  page_table_[page_id] = replace_frame_id;
-  latch_.unlock();
-  return replace_page;
+  counters_.misses_.fetch_add(1, std::memory_order_relaxed);
+  bool verified = disk_manager_->ReadPage(page_id, page->GetData());
+  {
+    std::scoped_lock load_latch(load_latch_);
+    load_failed_[frame_id] = !verified;
+    loading_[frame_id] = false;
+  }
+  load_cv_.notify_all();
+  if (!verified) {
+    // A page that failed verification reads as zeros, which would pass for a valid page, e.g. a table page whose next
+    // page is page 0. The fetch fails instead, and so do those of the threads that waited for the read.
+    partition.latch_.WLock();
+    partition.table_.erase(page_id);
+    partition.latch_.WUnlock();
+    ReleaseFailedFrame(page);
+    return nullptr;
+  }
+  return page;
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
@@ -179,55 +307,477 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  if(page_table_.find(page_id)==page_table_.end()) {
+  if (!ValidatePageId(page_id)) {
+    // Never allocated: freeing it would let AllocatePage hand out a page that does not exist, or one twice.
+    return false;
+  }
+  auto latch = LockLatch();
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.WLock();
+  auto iter = partition.table_.find(page_id);
+  if (iter == partition.table_.end()) {
+    partition.latch_.WUnlock();
+    // The page is only on disk.
+    DeallocatePage(page_id);
+    counters_.deleted_pages_.fetch_add(1, std::memory_order_relaxed);
     return true;
   }
-  auto i = page_table_[page_id];
-  if(pages_[i].GetPinCount() > 0)
+  frame_id_t frame_id = iter->second;
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ > 0) {
+    partition.latch_.WUnlock();
     return false;
-  
-  latch_.lock();
+  }
+  partition.table_.erase(iter);
+  partition.latch_.WUnlock();
+
+  replacer_->Remove(frame_id);
   DeallocatePage(page_id);
-  pages_[i].ResetMemory();
-  pages_[i].page_id_ = INVALID_PAGE_ID;
-  pages_[i].pin_count_ = 0;
-  pages_[i].is_dirty_ = false;
-  latch_.unlock();
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->pin_count_ = 0;
+  page->is_dirty_ = false;
+  free_list_.push_back(frame_id);
+  counters_.deleted_pages_.fetch_add(1, std::memory_order_relaxed);
+  if (frame_waiters_ > 0) {
+    frame_cv_.notify_all();
+  }
+  return true;
+}
+
+auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.RLock();
+  auto iter = partition.table_.find(page_id);
+  if (iter == partition.table_.end()) {
+    partition.latch_.RUnlock();
+    return false;
+  }
+  frame_id_t frame_id = iter->second;
+  Page *page = &pages_[frame_id];
+  // Set the dirty flag before dropping the pin so that whoever evicts the page sees it.
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count <= 0) {
+      partition.latch_.RUnlock();
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1));
+
+  if (pin_count == 1) {
+    replacer_->Unpin(frame_id);
+  }
+  partition.latch_.RUnlock();
+  if (pin_count == 1) {
+    NotifyFrameWaiters();
+  }
+  return true;
+}
 
+auto BufferPoolManagerInstance::UnpinFrame(Page *page, bool is_dirty) -> bool {
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count <= 0) {
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1));
+
+  if (pin_count == 1) {
+    replacer_->Unpin(static_cast<frame_id_t>(page - pages_));
+    NotifyFrameWaiters();
+  }
   return true;
 }
 
-auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool { 
-  latch_.lock();
-  
-  if(page_table_.find(page_id)==page_table_.end()) {
-    latch_.unlock();
+void BufferPoolManagerInstance::UnpinReadAheadPage(Page *page) {
+  // A page read in for read-ahead enters the replacer without an access; one that was resident keeps its history.
+  if (--page->pin_count_ == 0) {
+    replacer_->UnpinUnreferenced(static_cast<frame_id_t>(page - pages_));
+    NotifyFrameWaiters();
+  }
+}
+
+auto BufferPoolManagerInstance::SetFrameBudget(size_t num_frames) -> size_t {
+  auto latch = LockLatch();
+  num_frames = std::min(num_frames, pool_size_);
+  if (num_frames_ < num_frames && frame_waiters_ > 0) {
+    frame_cv_.notify_all();
+  }
+  while (num_frames_ < num_frames) {
+    free_list_.push_back(reserve_list_.back());
+    reserve_list_.pop_back();
+    num_frames_++;
+  }
+  while (num_frames_ > num_frames) {
+    frame_id_t frame_id;
+    if (!free_list_.empty()) {
+      // Prefer the frames at the end, so that frames in use stay at the start of the frame memory.
+      frame_id = free_list_.back();
+      free_list_.pop_back();
+    } else if (!AcquireFrame(&frame_id)) {
+      break;
+    }
+    Page *page = &pages_[frame_id];
+    page->page_id_ = INVALID_PAGE_ID;
+    page->pin_count_ = 0;
+    page->is_dirty_ = false;
+    // Hands the memory back to the OS. It reads as zeros when the frame is used again.
+    madvise(page->GetData(), PAGE_SIZE, MADV_DONTNEED);
+    reserve_list_.push_back(frame_id);
+    num_frames_--;
+  }
+  return num_frames_;
+}
+
+auto BufferPoolManagerInstance::GetStats() const -> BufferPoolStats {
+  BufferPoolStats stats;
+  stats.AddCounters(counters_);
+  stats.prefetches_ = prefetcher_->GetPrefetchCount();
+  stats.frames_ = num_frames_;
+  for (size_t i = 0; i < pool_size_; i++) {
+    if (pages_[i].page_id_ != INVALID_PAGE_ID) {
+      stats.AddResidentPage(pages_[i].pin_count_, pages_[i].is_dirty_);
+    }
+  }
+  return stats;
+}
+
+auto BufferPoolManagerInstance::LockLatch() -> std::unique_lock<std::mutex> {
+  std::unique_lock latch(latch_, std::try_to_lock);
+  if (!latch.owns_lock()) {
+    auto start = std::chrono::steady_clock::now();
+    latch.lock();
+    counters_.latch_waits_.fetch_add(1, std::memory_order_relaxed);
+    counters_.latch_wait_ns_.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+        std::memory_order_relaxed);
+  }
+  return latch;
+}
+
+auto BufferPoolManagerInstance::PinResidentPage(page_id_t page_id, bool referenced) -> Page * {
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.RLock();
+  auto iter = partition.table_.find(page_id);
+  if (iter == partition.table_.end()) {
+    partition.latch_.RUnlock();
+    return nullptr;
+  }
+  frame_id_t frame_id = iter->second;
+  Page *page = &pages_[frame_id];
+  // Eviction takes the partition latch in write mode, so the frame cannot change hands while we pin it.
+  if (page->pin_count_++ == 0 && referenced) {
+    replacer_->Pin(frame_id);
+  }
+  partition.latch_.RUnlock();
+  return page;
+}
+
+auto BufferPoolManagerInstance::WaitUntilLoaded(frame_id_t frame_id) -> bool {
+  if (loading_[frame_id]) {
+    std::unique_lock load_latch(load_latch_);
+    load_cv_.wait(load_latch, [this, frame_id] { return !loading_[frame_id]; });
+  }
+  return !load_failed_[frame_id];
+}
+
+void BufferPoolManagerInstance::ReleaseFailedFrame(Page *page) {
+  if (--page->pin_count_ > 0) {
+    return;
+  }
+  auto latch = LockLatch();
+  auto frame_id = static_cast<frame_id_t>(page - pages_);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  load_failed_[frame_id] = false;
+  replacer_->Remove(frame_id);
+  free_list_.push_back(frame_id);
+  if (frame_waiters_ > 0) {
+    frame_cv_.notify_all();
+  }
+}
+
+auto BufferPoolManagerInstance::AcquireFrame(frame_id_t *frame_id) -> bool {
+  if (!free_list_.empty()) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    return true;
+  }
+
+  // While the background writer runs, pass over a few dirty victims in the hope of finding a clean one. They go back
+  // to the replacer and the writer cleans them shortly.
+  std::vector<frame_id_t> dirty_victims;
+  bool found = false;
+  while (!found && replacer_->Victim(frame_id)) {
+    bool clean_only = background_writer_enabled_ && dirty_victims.size() < MAX_DIRTY_VICTIM_SKIPS;
+    switch (TryEvictFrame(*frame_id, clean_only)) {
+      case EvictResult::EVICTED:
+        found = true;
+        break;
+      case EvictResult::DIRTY:
+        dirty_victims.push_back(*frame_id);
+        break;
+      case EvictResult::PINNED:
+        break;
+    }
+  }
+
+  if (dirty_victims.empty()) {
+    return found;
+  }
+  for (frame_id_t dirty_frame_id : dirty_victims) {
+    if (!found && TryEvictFrame(dirty_frame_id, false) == EvictResult::EVICTED) {
+      *frame_id = dirty_frame_id;
+      found = true;
+    } else {
+      replacer_->Unpin(dirty_frame_id);
+    }
+  }
+  WakeBackgroundWriter();
+  return found;
+}
+
+auto BufferPoolManagerInstance::AcquireFrameOrWait(std::unique_lock<std::mutex> *latch, frame_id_t *frame_id,
+                                                   std::chrono::milliseconds timeout, page_id_t page_id) -> bool {
+  if (AcquireFrame(frame_id)) {
+    return true;
+  }
+  if (timeout.count() <= 0) {
     return false;
   }
-  auto i = page_table_[page_id];
+  auto is_resident = [this, page_id] {
+    if (page_id == INVALID_PAGE_ID) {
+      return false;
+    }
+    auto &partition = GetPageTablePartition(page_id);
+    partition.latch_.RLock();
+    bool found = partition.table_.count(page_id) > 0;
+    partition.latch_.RUnlock();
+    return found;
+  };
 
-  if(is_dirty)
-    pages_[i].is_dirty_ = true;
+  auto start = std::chrono::steady_clock::now();
+  counters_.frame_waits_.fetch_add(1, std::memory_order_relaxed);
+  // Check the frames once more after registering: an unpin in between did not see this waiter.
+  frame_waiters_++;
+  bool found = false;
+  bool timed_out = false;
+  while (!is_resident()) {
+    if (AcquireFrame(frame_id)) {
+      found = true;
+      break;
+    }
+    if (timed_out) {
+      counters_.frame_wait_timeouts_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    timed_out = frame_cv_.wait_until(*latch, start + timeout) == std::cv_status::timeout;
+  }
+  frame_waiters_--;
+  counters_.frame_wait_ns_.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+      std::memory_order_relaxed);
+  return found;
+}
 
-  if(pages_[i].pin_count_ > 0)
-    pages_[i].pin_count_--;
+void BufferPoolManagerInstance::NotifyFrameWaiters() {
+  if (frame_waiters_ == 0) {
+    return;
+  }
+  // A waiter holds latch_ from its last look at the frames until it sleeps, so taking latch_ here makes sure the
+  // notification does not fall in between.
+  { std::scoped_lock latch(latch_); }
+  frame_cv_.notify_all();
+}
 
-  if(!pages_[i].pin_count_)
-    replacer_->Unpin(i);
+auto BufferPoolManagerInstance::TryEvictFrame(frame_id_t frame_id, bool clean_only) -> EvictResult {
+  // Pins and unpins reach the replacer without latch_, so its view can be stale: a frame it hands out may have been
+  // pinned again since, or may already sit in the free list. Such frames are dropped here; a pinned one re-enters the
+  // replacer on its next unpin.
+  Page *victim = &pages_[frame_id];
+  page_id_t page_id = victim->page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    return EvictResult::PINNED;
+  }
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.WLock();
+  if (victim->pin_count_ > 0) {
+    partition.latch_.WUnlock();
+    return EvictResult::PINNED;
+  }
+  if (clean_only && victim->IsDirty()) {
+    partition.latch_.WUnlock();
+    return EvictResult::DIRTY;
+  }
+  partition.table_.erase(page_id);
+  partition.latch_.WUnlock();
+  replacer_->Remove(frame_id);
 
-  latch_.unlock();
-  return true; 
+  if (victim->IsDirty()) {
+    WritePageToDisk(victim);
+    counters_.foreground_writes_.fetch_add(1, std::memory_order_relaxed);
+  }
+  counters_.evictions_.fetch_add(1, std::memory_order_relaxed);
+  return EvictResult::EVICTED;
+}
+
+void BufferPoolManagerInstance::WritePageToDisk(Page *page) {
+  if (enable_logging && log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush(true);
+  }
+  // Clear the flag first so that a concurrent UnpinPage(page_id, true) is not lost.
+  page->is_dirty_ = false;
+  disk_manager_->WritePage(page->GetPageId(), page->GetData());
+}
+
+void BufferPoolManagerInstance::RunBackgroundWriter(size_t clean_frame_target, std::chrono::milliseconds interval) {
+  if (background_writer_enabled_) {
+    return;
+  }
+  background_writer_enabled_ = true;
+  background_writer_ = new std::thread(&BufferPoolManagerInstance::BackgroundWriterLoop, this,
+                                       std::min(clean_frame_target, pool_size_), interval);
+}
+
+void BufferPoolManagerInstance::StopBackgroundWriter() {
+  if (!background_writer_enabled_) {
+    return;
+  }
+  {
+    std::scoped_lock wakeup_latch(background_writer_latch_);
+    background_writer_enabled_ = false;
+  }
+  background_writer_cv_.notify_one();
+  background_writer_->join();
+  delete background_writer_;
+  background_writer_ = nullptr;
+}
+
+void BufferPoolManagerInstance::WakeBackgroundWriter() {
+  {
+    std::scoped_lock wakeup_latch(background_writer_latch_);
+    background_writer_wakeup_ = true;
+  }
+  background_writer_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::BackgroundWriterLoop(size_t clean_frame_target, std::chrono::milliseconds interval) {
+  while (true) {
+    {
+      std::unique_lock wakeup_latch(background_writer_latch_);
+      background_writer_cv_.wait_for(wakeup_latch, interval,
+                                     [&] { return background_writer_wakeup_ || !background_writer_enabled_; });
+      if (!background_writer_enabled_) {
+        return;
+      }
+      background_writer_wakeup_ = false;
+    }
+    CleanFrames(clean_frame_target);
+  }
+}
+
+void BufferPoolManagerInstance::CleanFrames(size_t clean_frame_target) {
+  size_t clean_frames;
+  {
+    auto latch = LockLatch();
+    clean_frames = free_list_.size();
+  }
+
+  // Count the evictable clean frames and remember the dirty candidates, in sweep order starting at the hand.
+  std::vector<frame_id_t> dirty_frames;
+  for (size_t i = 0; i < pool_size_ && clean_frames < clean_frame_target; i++) {
+    auto frame_id = static_cast<frame_id_t>((background_writer_hand_ + i) % pool_size_);
+    Page *page = &pages_[frame_id];
+    if (page->page_id_ == INVALID_PAGE_ID || page->pin_count_ > 0) {
+      continue;
+    }
+    if (page->IsDirty()) {
+      dirty_frames.push_back(frame_id);
+    } else {
+      clean_frames++;
+    }
+  }
+
+  for (frame_id_t frame_id : dirty_frames) {
+    if (clean_frames >= clean_frame_target || !background_writer_enabled_) {
+      break;
+    }
+    background_writer_hand_ = (frame_id + 1) % pool_size_;
+    Page *page = &pages_[frame_id];
+    page_id_t page_id = page->page_id_;
+    if (page_id == INVALID_PAGE_ID) {
+      continue;
+    }
+
+    // The page may have been cleaned or evicted since the sweep, and even read back into another frame.
+    Page *pinned_page = PinForWriteBack(page_id);
+    if (pinned_page != page) {
+      if (pinned_page != nullptr) {
+        UnpinAfterWriteBack(pinned_page);
+      }
+      continue;
+    }
+
+    page->RLatch();
+    if (page->IsDirty()) {
+      WritePageToDisk(page);
+      counters_.background_writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+    page->RUnlatch();
+    clean_frames++;
+
+    UnpinAfterWriteBack(page);
+  }
+}
+
+auto BufferPoolManagerInstance::PinForWriteBack(page_id_t page_id) -> Page * {
+  // The replacer is left alone: a miss that picks the frame meanwhile sees the pin and drops it, and
+  // UnpinAfterWriteBack puts it back.
+  auto &partition = GetPageTablePartition(page_id);
+  partition.latch_.RLock();
+  auto iter = partition.table_.find(page_id);
+  // A page that is still being read in is identical to its disk copy.
+  if (iter == partition.table_.end() || loading_[iter->second] || !pages_[iter->second].IsDirty()) {
+    partition.latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = &pages_[iter->second];
+  page->pin_count_++;
+  partition.latch_.RUnlock();
+  return page;
+}
+
+void BufferPoolManagerInstance::UnpinAfterWriteBack(Page *page) {
+  if (--page->pin_count_ == 0) {
+    replacer_->Unpin(static_cast<frame_id_t>(page - pages_));
+    NotifyFrameWaiters();
+  }
 }
 
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
+  const page_id_t free_page_id = disk_manager_->AllocateFreePage(num_instances_, instance_index_);
+  if (free_page_id != INVALID_PAGE_ID) {
+    assert(ValidatePageId(free_page_id));
+    return free_page_id;
+  }
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
-  ValidatePageId(next_page_id);
+  disk_manager_->RecordAllocatedPage(next_page_id);
+  assert(ValidatePageId(next_page_id));
   return next_page_id;
 }
 
-void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
-  assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
+auto BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const -> bool {
+  // allocated pages mod back to this BPI
+  return page_id % num_instances_ == instance_index_ && disk_manager_->IsAllocatedPage(page_id);
 }
 
 }  // namespace bustub
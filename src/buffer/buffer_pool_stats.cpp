@@ -0,0 +1,153 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace bustub {
+
+void LatencyHistogram::Record(uint64_t ns) {
+  // Index of the highest set bit, i.e. floor(log2(ns)).
+  size_t bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+  buckets_[std::min(bucket, NUM_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+  total_ns_.fetch_add(ns, std::memory_order_relaxed);
+}
+
+auto LatencyHistogram::GetSnapshot() const -> Snapshot {
+  Snapshot snapshot;
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    snapshot.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.count_ += snapshot.buckets_[i];
+  }
+  snapshot.total_ns_ = total_ns_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+auto LatencyHistogram::Snapshot::Percentile(double quantile) const -> uint64_t {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(quantile * count_));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets_[i];
+    if (seen >= rank && buckets_[i] > 0) {
+      return (uint64_t{1} << (i + 1)) - 1;
+    }
+  }
+  return (uint64_t{1} << NUM_BUCKETS) - 1;
+}
+
+auto LatencyHistogram::Snapshot::operator+=(const Snapshot &other) -> Snapshot & {
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  total_ns_ += other.total_ns_;
+  return *this;
+}
+
+void BufferPoolStats::AddCounters(const BufferPoolCounters &counters) {
+  hits_ += counters.hits_.load(std::memory_order_relaxed);
+  misses_ += counters.misses_.load(std::memory_order_relaxed);
+  new_pages_ += counters.new_pages_.load(std::memory_order_relaxed);
+  deleted_pages_ += counters.deleted_pages_.load(std::memory_order_relaxed);
+  evictions_ += counters.evictions_.load(std::memory_order_relaxed);
+  foreground_writes_ += counters.foreground_writes_.load(std::memory_order_relaxed);
+  background_writes_ += counters.background_writes_.load(std::memory_order_relaxed);
+  flush_writes_ += counters.flush_writes_.load(std::memory_order_relaxed);
+  latch_waits_ += counters.latch_waits_.load(std::memory_order_relaxed);
+  latch_wait_ns_ += counters.latch_wait_ns_.load(std::memory_order_relaxed);
+  frame_waits_ += counters.frame_waits_.load(std::memory_order_relaxed);
+  frame_wait_timeouts_ += counters.frame_wait_timeouts_.load(std::memory_order_relaxed);
+  frame_wait_ns_ += counters.frame_wait_ns_.load(std::memory_order_relaxed);
+  fetch_latency_ += counters.fetch_latency_.GetSnapshot();
+  new_page_latency_ += counters.new_page_latency_.GetSnapshot();
+  flush_latency_ += counters.flush_latency_.GetSnapshot();
+}
+
+void BufferPoolStats::AddResidentPage(int pin_count, bool is_dirty) {
+  resident_pages_++;
+  if (is_dirty) {
+    dirty_pages_++;
+  }
+  size_t bucket;
+  if (pin_count <= 2) {
+    bucket = std::max(pin_count, 0);
+  } else if (pin_count <= 4) {
+    bucket = 3;
+  } else if (pin_count <= 8) {
+    bucket = 4;
+  } else {
+    bucket = 5;
+  }
+  pin_counts_[bucket]++;
+}
+
+auto BufferPoolStats::HitRatio() const -> double {
+  uint64_t fetches = hits_ + misses_;
+  return fetches == 0 ? 0 : static_cast<double>(hits_) / fetches;
+}
+
+auto BufferPoolStats::operator+=(const BufferPoolStats &other) -> BufferPoolStats & {
+  frames_ += other.frames_;
+  resident_pages_ += other.resident_pages_;
+  dirty_pages_ += other.dirty_pages_;
+  for (size_t i = 0; i < PIN_COUNT_BUCKETS; i++) {
+    pin_counts_[i] += other.pin_counts_[i];
+  }
+  hits_ += other.hits_;
+  misses_ += other.misses_;
+  new_pages_ += other.new_pages_;
+  deleted_pages_ += other.deleted_pages_;
+  evictions_ += other.evictions_;
+  foreground_writes_ += other.foreground_writes_;
+  background_writes_ += other.background_writes_;
+  flush_writes_ += other.flush_writes_;
+  prefetches_ += other.prefetches_;
+  latch_waits_ += other.latch_waits_;
+  latch_wait_ns_ += other.latch_wait_ns_;
+  frame_waits_ += other.frame_waits_;
+  frame_wait_timeouts_ += other.frame_wait_timeouts_;
+  frame_wait_ns_ += other.frame_wait_ns_;
+  fetch_latency_ += other.fetch_latency_;
+  new_page_latency_ += other.new_page_latency_;
+  flush_latency_ += other.flush_latency_;
+  return *this;
+}
+
+auto BufferPoolStats::ToString() const -> std::string {
+  std::ostringstream out;
+  out << "frames=" << frames_ << " resident=" << resident_pages_ << " dirty=" << dirty_pages_ << " pin_counts=";
+  for (size_t i = 0; i < PIN_COUNT_BUCKETS; i++) {
+    out << (i == 0 ? "" : "/") << pin_counts_[i];
+  }
+  out << " hits=" << hits_ << " misses=" << misses_ << " hit_ratio=" << std::fixed << std::setprecision(3)
+      << HitRatio() << " new=" << new_pages_ << " deleted=" << deleted_pages_ << " evictions=" << evictions_
+      << " writes=" << foreground_writes_ << "/" << background_writes_ << "/" << flush_writes_
+      << " prefetches=" << prefetches_ << " latch_waits=" << latch_waits_ << " latch_wait_ms=" << std::setprecision(1)
+      << latch_wait_ns_ / 1e6;
+  if (frame_waits_ > 0) {
+    out << " frame_waits=" << frame_waits_ << " frame_wait_timeouts=" << frame_wait_timeouts_
+        << " frame_wait_ms=" << frame_wait_ns_ / 1e6;
+  }
+  if (fetch_latency_.count_ > 0) {
+    out << " fetch_p50_ns=" << fetch_latency_.Percentile(0.5) << " fetch_p99_ns=" << fetch_latency_.Percentile(0.99);
+  }
+  return out.str();
+}
+
+}  // namespace bustub
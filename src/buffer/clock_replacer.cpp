@@ -12,18 +12,72 @@
 
 #include "buffer/clock_replacer.h"
 
+#include <algorithm>
+
+#include "common/macros.h"
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : num_pages_(num_pages),
+      bits_(std::make_unique<std::atomic<uint64_t>[]>((num_pages + FRAMES_PER_WORD - 1) / FRAMES_PER_WORD)) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock latch(hand_latch_);
+  // Two full turns are enough: the first clears every reference bit it passes, the second finds any frame that stayed
+  // evictable. Frames unpinned during the sweep may be missed, which is fine for an approximate policy.
+  size_t budget = 2 * num_pages_ + 1;
+  while (budget > 0 && size_ > 0) {
+    std::atomic<uint64_t> &word = bits_[WordIndex(hand_)];
+    uint64_t evictable_bit = EvictableBit(hand_);
+    uint64_t referenced_bit = evictable_bit << 1;
+    uint64_t value = word.load();
+
+    if ((value & EVICTABLE_BITS & ~(evictable_bit - 1)) == 0) {
+      // No evictable frame at or after the hand in this word.
+      size_t skipped = std::min(FRAMES_PER_WORD - hand_ % FRAMES_PER_WORD, num_pages_ - hand_);
+      AdvanceHand(skipped);
+      budget -= std::min(skipped, budget);
+      continue;
+    }
+
+    if ((value & evictable_bit) != 0) {
+      if ((value & referenced_bit) != 0) {
+        word.fetch_and(~referenced_bit);
+      } else if ((word.fetch_and(~(evictable_bit | referenced_bit)) & evictable_bit) != 0) {
+        // The frame may have been pinned since the load; only a successful clear of its evictable bit claims it.
+        *frame_id = static_cast<frame_id_t>(hand_);
+        size_--;
+        AdvanceHand(1);
+        return true;
+      }
+    }
+    AdvanceHand(1);
+    budget--;
+  }
+  return false;
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  uint64_t evictable_bit = EvictableBit(frame_id);
+  uint64_t old_value = bits_[WordIndex(frame_id)].fetch_and(~(evictable_bit | evictable_bit << 1));
+  if ((old_value & evictable_bit) != 0) {
+    size_--;
+  }
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  uint64_t evictable_bit = EvictableBit(frame_id);
+  uint64_t old_value = bits_[WordIndex(frame_id)].fetch_or(evictable_bit | evictable_bit << 1);
+  if ((old_value & evictable_bit) == 0) {
+    size_++;
+  }
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+auto ClockReplacer::Size() -> size_t { return size_; }
 
 }  // namespace bustub
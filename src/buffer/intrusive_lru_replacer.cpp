@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer.cpp
+//
+// Identification: src/buffer/intrusive_lru_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/intrusive_lru_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+IntrusiveLRUReplacer::IntrusiveLRUReplacer(size_t num_pages)
+    : head_(static_cast<frame_id_t>(num_pages)), nodes_(num_pages + 1) {
+  nodes_[head_].prev_ = head_;
+  nodes_[head_].next_ = head_;
+}
+
+IntrusiveLRUReplacer::~IntrusiveLRUReplacer() = default;
+
+auto IntrusiveLRUReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock latch(latch_);
+  if (size_ == 0) {
+    return false;
+  }
+  *frame_id = nodes_[head_].next_;
+  Unlink(*frame_id);
+  return true;
+}
+
+void IntrusiveLRUReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  std::scoped_lock latch(latch_);
+  if (nodes_[frame_id].in_list_) {
+    Unlink(frame_id);
+  }
+}
+
+void IntrusiveLRUReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  std::scoped_lock latch(latch_);
+  ListNode &node = nodes_[frame_id];
+  if (node.in_list_) {
+    return;
+  }
+  frame_id_t tail = nodes_[head_].prev_;
+  node.prev_ = tail;
+  node.next_ = head_;
+  node.in_list_ = true;
+  nodes_[tail].next_ = frame_id;
+  nodes_[head_].prev_ = frame_id;
+  size_++;
+}
+
+auto IntrusiveLRUReplacer::Size() -> size_t {
+  std::scoped_lock latch(latch_);
+  return size_;
+}
+
+void IntrusiveLRUReplacer::Unlink(frame_id_t frame_id) {
+  ListNode &node = nodes_[frame_id];
+  nodes_[node.prev_].next_ = node.next_;
+  nodes_[node.next_].prev_ = node.prev_;
+  node.in_list_ = false;
+  size_--;
+}
+
+}  // namespace bustub
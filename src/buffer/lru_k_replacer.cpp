@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k)
+    : k_(k), history_(num_pages * k), access_counts_(num_pages), evictable_(num_pages) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs at least one access per frame");
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+auto LRUKReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock latch(latch_);
+  auto &queue = history_queue_.empty() ? cache_queue_ : history_queue_;
+  if (queue.empty()) {
+    return false;
+  }
+  *frame_id = queue.begin()->second;
+  queue.erase(queue.begin());
+  // The history stays: the buffer pool may still pass over the frame (e.g. because it is dirty) and hand it back. It
+  // is cleared through Remove() once the page has actually left the frame.
+  evictable_[*frame_id] = false;
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  if (evictable_[frame_id]) {
+    (HasInfiniteDistance(frame_id) ? history_queue_ : cache_queue_).erase(EvictionKey(frame_id));
+    evictable_[frame_id] = false;
+  }
+  RecordAccess(frame_id);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  if (evictable_[frame_id]) {
+    return;
+  }
+  // A frame that was never pinned through the replacer starts out with a single access. A victim that is handed back
+  // keeps the history it had.
+  if (access_counts_[frame_id] == 0) {
+    RecordAccess(frame_id);
+  }
+  evictable_[frame_id] = true;
+  (HasInfiniteDistance(frame_id) ? history_queue_ : cache_queue_).insert(EvictionKey(frame_id));
+}
+
+void LRUKReplacer::UnpinUnreferenced(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  if (evictable_[frame_id]) {
+    return;
+  }
+  // Slot 0 orders a frame without accesses by the time it became evictable. Its first access overwrites the slot.
+  if (access_counts_[frame_id] == 0) {
+    history_[frame_id * k_] = ++current_timestamp_;
+  }
+  evictable_[frame_id] = true;
+  (HasInfiniteDistance(frame_id) ? history_queue_ : cache_queue_).insert(EvictionKey(frame_id));
+}
+
+auto LRUKReplacer::Size() -> size_t {
+  std::scoped_lock latch(latch_);
+  return history_queue_.size() + cache_queue_.size();
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  if (evictable_[frame_id]) {
+    (HasInfiniteDistance(frame_id) ? history_queue_ : cache_queue_).erase(EvictionKey(frame_id));
+    evictable_[frame_id] = false;
+  }
+  ClearHistory(frame_id);
+}
+
+void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  history_[frame_id * k_ + access_counts_[frame_id] % k_] = ++current_timestamp_;
+  access_counts_[frame_id]++;
+}
+
+auto LRUKReplacer::EvictionKey(frame_id_t frame_id) const -> std::pair<uint64_t, frame_id_t> {
+  // With fewer than k_ accesses the earliest one sits in slot 0. Otherwise the slot that would be overwritten next
+  // holds the K-th most recent access.
+  size_t slot = HasInfiniteDistance(frame_id) ? 0 : access_counts_[frame_id] % k_;
+  return {history_[frame_id * k_ + slot], frame_id};
+}
+
+void LRUKReplacer::ClearHistory(frame_id_t frame_id) { access_counts_[frame_id] = 0; }
+
+}  // namespace bustub
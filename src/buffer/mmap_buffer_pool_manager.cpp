@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager.cpp
+//
+// Identification: src/buffer/mmap_buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/mmap_buffer_pool_manager.h"
+
+#include <sys/mman.h>
+
+namespace bustub {
+
+MmapBufferPoolManager::MmapBufferPoolManager(DiskManager *disk_manager) : num_pages_(0) {
+  // The mapping is read-only, so any write through page data faults instead of silently diverging from the file.
+  data_ = const_cast<char *>(disk_manager->MapReadOnly(&num_pages_));
+  pages_ = std::make_unique<std::atomic<Page *>[]>(num_pages_);
+  for (size_t i = 0; i < num_pages_; i++) {
+    pages_[i] = nullptr;
+  }
+}
+
+MmapBufferPoolManager::~MmapBufferPoolManager() {
+  for (size_t i = 0; i < num_pages_; i++) {
+    delete pages_[i].load();
+  }
+}
+
+void MmapBufferPoolManager::PrefetchPages(const std::vector<page_id_t> &page_ids) {
+  for (page_id_t page_id : page_ids) {
+    if (page_id >= 0 && static_cast<size_t>(page_id) < num_pages_) {
+      madvise(data_ + static_cast<size_t>(page_id) * PAGE_SIZE, PAGE_SIZE, MADV_WILLNEED);
+    }
+  }
+}
+
+auto MmapBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= num_pages_) {
+    return nullptr;
+  }
+  Page *page = pages_[page_id];
+  if (page == nullptr) {
+    auto *new_page = new Page();
+    new_page->data_ = data_ + static_cast<size_t>(page_id) * PAGE_SIZE;
+    new_page->page_id_ = page_id;
+    // Another thread may have created the Page first; then everybody uses that one.
+    if (pages_[page_id].compare_exchange_strong(page, new_page)) {
+      page = new_page;
+    } else {
+      delete new_page;
+    }
+  }
+  page->pin_count_++;
+  return page;
+}
+
+auto MmapBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
+  Page *page = GetPage(page_id);
+  if (page == nullptr) {
+    return false;
+  }
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count <= 0) {
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1));
+  return true;
+}
+
+auto MmapBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
+  return page_id >= 0 && static_cast<size_t>(page_id) < num_pages_;
+}
+
+auto MmapBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
+  *page_id = INVALID_PAGE_ID;
+  return nullptr;
+}
+
+auto MmapBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool { return false; }
+
+auto MmapBufferPoolManager::GetPage(page_id_t page_id) -> Page * {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= num_pages_) {
+    return nullptr;
+  }
+  return pages_[page_id];
+}
+
+}  // namespace bustub
@@ -12,23 +12,59 @@
 
 #include "buffer/parallel_buffer_pool_manager.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "common/numa.h"
+
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager):
+                                                     LogManager *log_manager, ReplacerType replacer_type,
+                                                     bool numa_aware, bool frame_rebalancing):
                                                      num_instance(num_instances), 
                                                      pool_size_(pool_size),
                                                      starting_index(0),
                                                      disk_manager_(disk_manager),
                                                      log_manager_(log_manager),
-                                                     buffer_pool_managers(num_instances) {
-  // Allocate and create individual BufferPoolManagerInstances
-  for(size_t i = 0; i < num_instance; i++)
-    buffer_pool_managers[i] = new BufferPoolManagerInstance(pool_size_, num_instance, i, disk_manager_, log_manager_);
+                                                     buffer_pool_managers(num_instances),
+                                                     max_instance_frames_(pool_size *
+                                                                          (frame_rebalancing ? MAX_FRAME_GROWTH : 1)),
+                                                     frame_rebalancing_(frame_rebalancing),
+                                                     last_loads_(num_instances, InstanceLoad{0, 0, 0}),
+                                                     numa_aware_(numa_aware),
+                                                     num_numa_nodes_(NumaUtil::GetNumNodes()) {
+  // Allocate and create individual BufferPoolManagerInstances, dealing them out over the NUMA nodes if NUMA-aware
+  for(size_t i = 0; i < num_instance; i++) {
+    // With rebalancing every instance reserves frames to grow into; without it, only its configured size.
+    int numa_node = numa_aware_ ? static_cast<int>(i % num_numa_nodes_) : -1;
+    buffer_pool_managers[i] = new BufferPoolManagerInstance(max_instance_frames_, num_instance, i, disk_manager_,
+                                                            log_manager_, replacer_type, numa_node);
+    buffer_pool_managers[i]->SetFrameBudget(pool_size_);
+  }
+  remote_fetches_ = std::make_unique<std::atomic<uint64_t>[]>(num_numa_nodes_);
+  for (int node = 0; node < num_numa_nodes_; node++) {
+    remote_fetches_[node] = 0;
+  }
+  chain_prefetcher_ = std::make_unique<Prefetcher>(this, GetPoolSize());
+  // Rounds run off the fetch path: shrinking an instance can evict and write back its pages.
+  if (frame_rebalancing && num_instance > 1) {
+    rebalance_thread_ = new std::thread(&ParallelBufferPoolManager::RebalanceLoop, this);
+  }
 }
 
 // Update constructor to destruct all BufferPoolManagerInstances and deallocate any associated memory
 ParallelBufferPoolManager::~ParallelBufferPoolManager() {
+  if (rebalance_thread_ != nullptr) {
+    {
+      std::scoped_lock latch(rebalance_thread_latch_);
+      rebalance_thread_stopped_ = true;
+    }
+    rebalance_thread_cv_.notify_one();
+    rebalance_thread_->join();
+    delete rebalance_thread_;
+  }
+  chain_prefetcher_.reset();
   for(auto buffer_pool_manager: buffer_pool_managers)
     delete buffer_pool_manager;
 };
@@ -38,6 +74,145 @@ auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   return num_instance*pool_size_;
 }
 
+void ParallelBufferPoolManager::PrefetchPages(const std::vector<page_id_t> &page_ids) {
+  std::vector<std::vector<page_id_t>> instance_page_ids(num_instance);
+  for (page_id_t page_id : page_ids) {
+    instance_page_ids[page_id % num_instance].push_back(page_id);
+  }
+  for (size_t i = 0; i < num_instance; i++) {
+    if (!instance_page_ids[i].empty()) {
+      buffer_pool_managers[i]->PrefetchPages(instance_page_ids[i]);
+    }
+  }
+}
+
+void ParallelBufferPoolManager::PrefetchChain(page_id_t page_id, size_t num_pages, next_page_fn next_page) {
+  chain_prefetcher_->PrefetchChain(page_id, num_pages, std::move(next_page));
+}
+
+void ParallelBufferPoolManager::RunBackgroundWriters(size_t clean_frame_target, std::chrono::milliseconds interval) {
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    buffer_pool_manager->RunBackgroundWriter(clean_frame_target, interval);
+  }
+}
+
+void ParallelBufferPoolManager::StopBackgroundWriters() {
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    buffer_pool_manager->StopBackgroundWriter();
+  }
+}
+
+auto ParallelBufferPoolManager::GetInstanceStats() const -> std::vector<BufferPoolStats> {
+  std::vector<BufferPoolStats> stats;
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    stats.push_back(buffer_pool_manager->GetStats());
+  }
+  return stats;
+}
+
+auto ParallelBufferPoolManager::GetStats() const -> BufferPoolStats {
+  BufferPoolStats stats;
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    stats += buffer_pool_manager->GetStats();
+  }
+  stats.prefetches_ += chain_prefetcher_->GetPrefetchCount();
+  return stats;
+}
+
+void ParallelBufferPoolManager::SetLatencyTracking(bool enabled) {
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    buffer_pool_manager->SetLatencyTracking(enabled);
+  }
+}
+
+void ParallelBufferPoolManager::SetFrameWaitTimeout(std::chrono::milliseconds timeout) {
+  frame_wait_timeout_ = timeout;
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    buffer_pool_manager->SetFrameWaitTimeout(timeout);
+  }
+}
+
+void ParallelBufferPoolManager::RebalanceFrames() {
+  std::unique_lock latch(rebalance_latch_, std::try_to_lock);
+  if (!latch.owns_lock()) {
+    return;
+  }
+  std::vector<InstanceLoad> loads(num_instance);
+  InstanceLoad total{0, 0, 0};
+  for (size_t i = 0; i < num_instance; i++) {
+    const BufferPoolCounters &counters = buffer_pool_managers[i]->GetCounters();
+    InstanceLoad current{counters.misses_, counters.hits_ + counters.misses_, counters.latch_wait_ns_};
+    loads[i] = {current.misses_ - last_loads_[i].misses_, current.fetches_ - last_loads_[i].fetches_,
+                current.latch_wait_ns_ - last_loads_[i].latch_wait_ns_};
+    last_loads_[i] = current;
+    total.misses_ += loads[i].misses_;
+    total.fetches_ += loads[i].fetches_;
+    total.latch_wait_ns_ += loads[i].latch_wait_ns_;
+  }
+
+  // Every signal counts as the instance's share of it, so that none of them outweighs the others by its unit. The
+  // hottest instance misses the most, serves the most fetches and waits the longest for its latch.
+  auto share = [](uint64_t value, uint64_t total_value) {
+    return total_value == 0 ? 0.0 : static_cast<double>(value) / static_cast<double>(total_value);
+  };
+  std::vector<double> scores(num_instance);
+  size_t hot = 0;
+  size_t cold = 0;
+  for (size_t i = 0; i < num_instance; i++) {
+    scores[i] = share(loads[i].misses_, total.misses_) + share(loads[i].fetches_, total.fetches_) +
+                share(loads[i].latch_wait_ns_, total.latch_wait_ns_);
+    if (scores[i] > scores[hot]) {
+      hot = i;
+    }
+    if (scores[i] < scores[cold]) {
+      cold = i;
+    }
+  }
+  // Only act on a clear imbalance, so that frames do not shuttle back and forth between similar instances, and only
+  // for an instance that misses: more frames do nothing for one whose pages are all resident.
+  size_t step = std::max<size_t>(1, pool_size_ / FRAME_STEP_SHARE);
+  if (hot == cold || loads[hot].misses_ < step || scores[hot] < 2 * scores[cold]) {
+    return;
+  }
+  size_t hot_frames = buffer_pool_managers[hot]->GetPoolSize();
+  size_t cold_frames = buffer_pool_managers[cold]->GetPoolSize();
+  size_t min_frames = std::max<size_t>(1, pool_size_ / MIN_FRAME_SHARE);
+  step = std::min({step, max_instance_frames_ - hot_frames,
+                   cold_frames > min_frames ? cold_frames - min_frames : 0});
+  if (step == 0) {
+    return;
+  }
+  size_t released = cold_frames - buffer_pool_managers[cold]->SetFrameBudget(cold_frames - step);
+  buffer_pool_managers[hot]->SetFrameBudget(hot_frames + released);
+}
+
+void ParallelBufferPoolManager::RebalanceLoop() {
+  std::unique_lock latch(rebalance_thread_latch_);
+  while (!rebalance_thread_cv_.wait_for(latch, REBALANCE_INTERVAL, [this] { return rebalance_thread_stopped_; })) {
+    if (frame_rebalancing_) {
+      latch.unlock();
+      RebalanceFrames();
+      latch.lock();
+    }
+  }
+}
+
+auto ParallelBufferPoolManager::GetNumaNodeStats() const -> std::vector<NumaNodeStats> {
+  std::vector<NumaNodeStats> stats(num_numa_nodes_, NumaNodeStats{0, 0, 0});
+  for (auto *buffer_pool_manager : buffer_pool_managers) {
+    if (buffer_pool_manager->GetNumaNode() == -1) {
+      continue;
+    }
+    NumaNodeStats &node_stats = stats[buffer_pool_manager->GetNumaNode()];
+    node_stats.hits_ += buffer_pool_manager->GetCounters().hits_;
+    node_stats.misses_ += buffer_pool_manager->GetCounters().misses_;
+  }
+  for (int node = 0; node < num_numa_nodes_; node++) {
+    stats[node].remote_fetches_ = remote_fetches_[node];
+  }
+  return stats;
+}
+
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager * {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
   return buffer_pool_managers[page_id % num_instance];
@@ -45,7 +220,10 @@ auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> Buffe
 
 auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
   // Fetch page for page_id from responsible BufferPoolManagerInstance
-  BufferPoolManager *manager = GetBufferPoolManager(page_id);
+  BufferPoolManagerInstance *manager = buffer_pool_managers[page_id % num_instance];
+  if (numa_aware_ && num_numa_nodes_ > 1 && manager->GetNumaNode() != NumaUtil::GetCurrentNode()) {
+    remote_fetches_[manager->GetNumaNode()].fetch_add(1, std::memory_order_relaxed);
+  }
   return manager->FetchPage(page_id);
 }
 
@@ -55,6 +233,18 @@ auto ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) ->
   return manager->UnpinPage(page_id, is_dirty);
 }
 
+auto ParallelBufferPoolManager::UnpinFrame(Page *page, bool is_dirty) -> bool {
+  return GetBufferPoolManager(page->GetPageId())->UnpinFrame(page, is_dirty);
+}
+
+auto ParallelBufferPoolManager::FetchPageForReadAhead(page_id_t page_id) -> Page * {
+  return GetBufferPoolManager(page_id)->FetchPageForReadAhead(page_id);
+}
+
+void ParallelBufferPoolManager::UnpinReadAheadPage(Page *page) {
+  GetBufferPoolManager(page->GetPageId())->UnpinReadAheadPage(page);
+}
+
 auto ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
   // Flush page_id from responsible BufferPoolManagerInstance
   BufferPoolManager *manager = GetBufferPoolManager(page_id);
@@ -68,16 +258,32 @@ auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
   // starting index and return nullptr
   // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
   // is called
+  // 3.   With NUMA awareness, make one pass over the instances on the calling thread's node before the others.
+  // 4.   If every instance is full, wait for a frame in the starting instance, see SetFrameWaitTimeout.
   Page *result = nullptr;
-  size_t i = starting_index;
-  while(result == nullptr) {
-    result = buffer_pool_managers[i]->NewPage(page_id);
-    i = (i + 1) % num_instance;
-    if(i == starting_index)
-      break;
-  }
-  
-  starting_index = (i + 1) % num_instance;
+  size_t first_index = starting_index;
+  int node = numa_aware_ && num_numa_nodes_ > 1 ? NumaUtil::GetCurrentNode() : -1;
+  for (bool local_pass : {true, false}) {
+    if (node == -1 && local_pass) {
+      continue;
+    }
+    size_t i = starting_index;
+    while(result == nullptr) {
+      if (node == -1 || (buffer_pool_managers[i]->GetNumaNode() == node) == local_pass) {
+        result = buffer_pool_managers[i]->TryNewPage(page_id, std::chrono::milliseconds(0));
+      }
+      i = (i + 1) % num_instance;
+      if(i == starting_index)
+        break;
+    }
+  }
+  std::chrono::milliseconds frame_wait_timeout = frame_wait_timeout_;
+  if (result == nullptr && frame_wait_timeout.count() > 0) {
+    result = buffer_pool_managers[first_index]->TryNewPage(page_id, frame_wait_timeout);
+  }
+
+  // Advance by one instance only, so that consecutive new pages get consecutive page ids and every instance is used.
+  starting_index = (starting_index + 1) % num_instance;
   return result;
 }
 
@@ -88,9 +294,9 @@ auto ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool {
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
-  // flush all pages from all BufferPoolManagerInstances
-  for(auto &buffer_pool_manager: buffer_pool_managers)
-    buffer_pool_manager->FlushAllPages();
+  // flush all pages from all BufferPoolManagerInstances. Page ids are striped across instances, so only a combined
+  // batch has runs of adjacent pages to coalesce.
+  BufferPoolManagerInstance::FlushDirtyPages(buffer_pool_managers);
 }
 
 }  // namespace bustub
@@ -0,0 +1,97 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// prefetcher.cpp
+//
+// Identification: src/buffer/prefetcher.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/prefetcher.h"
+
+#include <utility>
+
+namespace bustub {
+
+Prefetcher::Prefetcher(BufferPoolManager *buffer_pool_manager, size_t max_queued_requests)
+    : buffer_pool_manager_(buffer_pool_manager), max_queued_requests_(max_queued_requests) {}
+
+Prefetcher::~Prefetcher() {
+  {
+    std::scoped_lock latch(latch_);
+    enabled_ = false;
+  }
+  queue_cv_.notify_one();
+  if (prefetch_thread_ != nullptr) {
+    prefetch_thread_->join();
+    delete prefetch_thread_;
+  }
+}
+
+void Prefetcher::PrefetchPages(const std::vector<page_id_t> &page_ids) {
+  for (page_id_t page_id : page_ids) {
+    Enqueue({page_id, 1, nullptr});
+  }
+}
+
+void Prefetcher::PrefetchChain(page_id_t page_id, size_t num_pages, BufferPoolManager::next_page_fn next_page) {
+  Enqueue({page_id, num_pages, std::move(next_page)});
+}
+
+void Prefetcher::Enqueue(PrefetchRequest request) {
+  if (request.page_id_ == INVALID_PAGE_ID || request.num_pages_ == 0) {
+    return;
+  }
+  {
+    std::scoped_lock latch(latch_);
+    if (queue_.size() >= max_queued_requests_) {
+      return;
+    }
+    queue_.push_back(std::move(request));
+    if (prefetch_thread_ == nullptr) {
+      prefetch_thread_ = new std::thread(&Prefetcher::PrefetchLoop, this);
+    }
+  }
+  queue_cv_.notify_one();
+}
+
+void Prefetcher::PrefetchLoop() {
+  while (true) {
+    PrefetchRequest request;
+    {
+      std::unique_lock latch(latch_);
+      queue_cv_.wait(latch, [&] { return !queue_.empty() || !enabled_; });
+      if (!enabled_) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    Prefetch(request);
+  }
+}
+
+void Prefetcher::Prefetch(const PrefetchRequest &request) {
+  page_id_t page_id = request.page_id_;
+  for (size_t i = 0; i < request.num_pages_ && page_id != INVALID_PAGE_ID && enabled_; i++) {
+    Page *page = buffer_pool_manager_->FetchPageForReadAhead(page_id);
+    if (page == nullptr) {
+      // Every frame is pinned; reading further ahead would only evict pages that are needed sooner.
+      return;
+    }
+    prefetch_count_++;
+    page_id_t next_page_id = INVALID_PAGE_ID;
+    if (request.next_page_ != nullptr && i + 1 < request.num_pages_) {
+      page->RLatch();
+      next_page_id = request.next_page_(page);
+      page->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinReadAheadPage(page);
+    page_id = next_page_id;
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,36 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// replacer_factory.cpp
+//
+// Identification: src/buffer/replacer_factory.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/replacer_factory.h"
+
+#include <memory>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/intrusive_lru_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+auto ReplacerFactory::CreateReplacer(ReplacerType type, size_t num_pages) -> std::unique_ptr<Replacer> {
+  switch (type) {
+    case ReplacerType::LRU:
+      return std::make_unique<IntrusiveLRUReplacer>(num_pages);
+    case ReplacerType::LRU_K:
+      return std::make_unique<LRUKReplacer>(num_pages);
+    case ReplacerType::CLOCK:
+      return std::make_unique<ClockReplacer>(num_pages);
+  }
+  UNREACHABLE("Unsupported replacer type.");
+}
+
+}  // namespace bustub
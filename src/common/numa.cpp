@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// numa.cpp
+//
+// Identification: src/common/numa.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/numa.h"
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <fstream>
+#include <string>
+
+namespace bustub {
+
+/** Number of emulated nodes, 0 if the real topology is used. */
+static std::atomic<int> emulated_num_nodes(0);
+/** Emulated node of the calling thread, -1 if it has not picked one. */
+static thread_local int emulated_current_node = -1;
+
+/** @return the number of nodes the kernel knows about, from the highest id in the list of possible nodes */
+static auto ReadNumNodes() -> int {
+  // The list looks like "0" or "0-1" or "0,2-3".
+  std::ifstream possible("/sys/devices/system/node/possible");
+  std::string nodes;
+  if (!std::getline(possible, nodes) || nodes.empty()) {
+    return 1;
+  }
+  size_t last = nodes.find_last_of(",-");
+  return std::stoi(last == std::string::npos ? nodes : nodes.substr(last + 1)) + 1;
+}
+
+auto NumaUtil::GetNumNodes() -> int {
+  int num_nodes = emulated_num_nodes;
+  if (num_nodes > 0) {
+    return num_nodes;
+  }
+  static const int real_num_nodes = ReadNumNodes();
+  return real_num_nodes;
+}
+
+auto NumaUtil::GetCurrentNode() -> int {
+  int num_nodes = emulated_num_nodes;
+  if (num_nodes > 0) {
+    return emulated_current_node >= 0 ? emulated_current_node % num_nodes : sched_getcpu() % num_nodes;
+  }
+  unsigned int cpu;
+  unsigned int node;
+  if (getcpu(&cpu, &node) != 0) {
+    return 0;
+  }
+  return static_cast<int>(node);
+}
+
+auto NumaUtil::BindToNode(void *addr, size_t size, int node) -> bool {
+  if (emulated_num_nodes > 0 || GetNumNodes() == 1) {
+    return true;
+  }
+  if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * CHAR_BIT)) {  // NOLINT
+    return false;
+  }
+  // MPOL_PREFERRED rather than MPOL_BIND: if the node runs out of memory, allocate elsewhere instead of failing.
+  unsigned long node_mask = 1UL << node;  // NOLINT
+  return syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &node_mask, sizeof(node_mask) * CHAR_BIT, 0) == 0;
+}
+
+void NumaUtil::EmulateNodes(int num_nodes) { emulated_num_nodes = num_nodes; }
+
+void NumaUtil::SetCurrentNode(int node) { emulated_current_node = node; }
+
+}  // namespace bustub
@@ -0,0 +1,151 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace bustub {
+
+/** Reflected CRC32C polynomial. */
+static constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+/**
+ * Bytes per stream in the hardware loop. Three streams of this size fill a 4 KiB page but for 16 bytes, and the
+ * block is long enough that combining the streams costs little.
+ */
+static constexpr size_t STREAM_BLOCK = 1360;
+
+/** Lookup table for the software CRC: the CRC register after shifting in one byte. */
+static auto ByteTable() -> const std::array<uint32_t, 256> & {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+      uint32_t crc = byte;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32C_POLY : 0);
+      }
+      table[byte] = crc;
+    }
+    return table;
+  }();
+  return table;
+}
+
+/** Advance the CRC register over a buffer, one byte at a time. No pre- or post-inversion. */
+static auto ExtendSoftware(uint32_t state, const char *data, size_t length) -> uint32_t {
+  const auto &table = ByteTable();
+  for (size_t i = 0; i < length; i++) {
+    state = table[(state ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (state >> 8);
+  }
+  return state;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Tables that advance the CRC register over STREAM_BLOCK zero bytes, one table per byte of the register. Shifting in
+ * zeros is linear, so it is the XOR of the shifts of the register bytes.
+ */
+static auto ShiftTables() -> const std::array<std::array<uint32_t, 256>, 4> & {
+  static const std::array<std::array<uint32_t, 256>, 4> tables = [] {
+    static const char zeros[STREAM_BLOCK] = {};
+    std::array<uint32_t, 32> bit_shifts{};
+    for (int bit = 0; bit < 32; bit++) {
+      bit_shifts[bit] = ExtendSoftware(1U << bit, zeros, STREAM_BLOCK);
+    }
+    std::array<std::array<uint32_t, 256>, 4> tables{};
+    for (int k = 0; k < 4; k++) {
+      for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t shifted = 0;
+        for (int bit = 0; bit < 8; bit++) {
+          if ((byte & (1U << bit)) != 0) {
+            shifted ^= bit_shifts[k * 8 + bit];
+          }
+        }
+        tables[k][byte] = shifted;
+      }
+    }
+    return tables;
+  }();
+  return tables;
+}
+
+/** @return the CRC register after shifting in STREAM_BLOCK zero bytes */
+static inline auto ShiftBlock(const std::array<std::array<uint32_t, 256>, 4> &tables, uint32_t state) -> uint32_t {
+  return tables[0][state & 0xff] ^ tables[1][(state >> 8) & 0xff] ^ tables[2][(state >> 16) & 0xff] ^
+         tables[3][state >> 24];
+}
+
+static inline auto Load64(const char *data) -> uint64_t {
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+/**
+ * Advance the CRC register with the crc32 instruction. Runs of three blocks are checksummed as three independent
+ * streams, the second and third starting from zero, and put together with the rule
+ * crc(s, A B) = shift(crc(s, A), |B|) ^ crc(0, B).
+ */
+__attribute__((target("sse4.2"))) static auto ExtendHardware(uint32_t state, const char *data, size_t length)
+    -> uint32_t {
+  const auto &tables = ShiftTables();
+  uint64_t crc = state;
+  while (length >= 3 * STREAM_BLOCK) {
+    uint64_t crc_b = 0;
+    uint64_t crc_c = 0;
+    for (size_t i = 0; i < STREAM_BLOCK; i += 8) {
+      crc = _mm_crc32_u64(crc, Load64(data + i));
+      crc_b = _mm_crc32_u64(crc_b, Load64(data + STREAM_BLOCK + i));
+      crc_c = _mm_crc32_u64(crc_c, Load64(data + 2 * STREAM_BLOCK + i));
+    }
+    uint32_t combined = ShiftBlock(tables, static_cast<uint32_t>(crc)) ^ static_cast<uint32_t>(crc_b);
+    crc = ShiftBlock(tables, combined) ^ static_cast<uint32_t>(crc_c);
+    data += 3 * STREAM_BLOCK;
+    length -= 3 * STREAM_BLOCK;
+  }
+  for (; length >= 8; data += 8, length -= 8) {
+    crc = _mm_crc32_u64(crc, Load64(data));
+  }
+  auto crc32 = static_cast<uint32_t>(crc);
+  for (; length > 0; data++, length--) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data));
+  }
+  return crc32;
+}
+
+auto Crc32c::IsHardwareAccelerated() -> bool {
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  return has_sse42;
+}
+
+auto Crc32c::Extend(uint32_t crc, const char *data, size_t length) -> uint32_t {
+  return IsHardwareAccelerated() ? ~ExtendHardware(~crc, data, length) : ~ExtendSoftware(~crc, data, length);
+}
+
+#else
+
+auto Crc32c::IsHardwareAccelerated() -> bool { return false; }
+
+auto Crc32c::Extend(uint32_t crc, const char *data, size_t length) -> uint32_t {
+  return ~ExtendSoftware(~crc, data, length);
+}
+
+#endif
+
+}  // namespace bustub
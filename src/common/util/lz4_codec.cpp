@@ -0,0 +1,193 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.cpp
+//
+// Identification: src/common/util/lz4_codec.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz4_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+constexpr int MIN_MATCH = 4;
+// The last match must start at least this many bytes before the end of the input...
+constexpr int MF_LIMIT = 12;
+// ...and the last this many bytes are always literals.
+constexpr int LAST_LITERALS = 5;
+constexpr int MAX_OFFSET = 65535;
+constexpr int HASH_LOG = 12;
+constexpr int ML_BITS = 4;
+constexpr unsigned ML_MASK = (1U << ML_BITS) - 1;
+constexpr unsigned RUN_MASK = (1U << (8 - ML_BITS)) - 1;
+
+auto Read32(const uint8_t *p) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+auto Hash(uint32_t sequence) -> uint32_t { return (sequence * 2654435761U) >> (32 - HASH_LOG); }
+
+/** Append a length beyond the 4 bits of its token nibble: runs of 255 and a final byte < 255. */
+auto WriteLength(uint8_t *op, size_t length) -> uint8_t * {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+/** Read a length continuation, adding it to *length. @return false if the input ends first */
+auto ReadLength(const uint8_t **ip, const uint8_t *iend, size_t *length) -> bool {
+  uint8_t s;
+  do {
+    if (*ip >= iend) {
+      return false;
+    }
+    s = *(*ip)++;
+    *length += s;
+  } while (s == 255);
+  return true;
+}
+
+}  // namespace
+
+auto Lz4Codec::CompressBound(int input_size) -> int { return input_size + input_size / 255 + 16; }
+
+auto Lz4Codec::Compress(const char *src, char *dst, int src_size, int dst_capacity) -> int {
+  const auto *istart = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *ip = istart;
+  const uint8_t *anchor = istart;
+  const uint8_t *iend = istart + src_size;
+  auto *op = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *oend = op + dst_capacity;
+
+  // Positions of recently seen 4-byte sequences, relative to the start of the input.
+  uint32_t table[1 << HASH_LOG] = {};
+  if (src_size >= MF_LIMIT + 1) {
+    const uint8_t *mflimit = iend - MF_LIMIT;
+    const uint8_t *matchlimit = iend - LAST_LITERALS;
+    while (ip < mflimit) {
+      uint32_t sequence = Read32(ip);
+      uint32_t h = Hash(sequence);
+      const uint8_t *ref = istart + table[h];
+      table[h] = static_cast<uint32_t>(ip - istart);
+      if (ref >= ip || ip - ref > MAX_OFFSET || Read32(ref) != sequence) {
+        ip++;
+        continue;
+      }
+
+      const uint8_t *match_end = ip + MIN_MATCH;
+      const uint8_t *ref_end = ref + MIN_MATCH;
+      while (match_end < matchlimit && *match_end == *ref_end) {
+        match_end++;
+        ref_end++;
+      }
+      auto literal_length = static_cast<size_t>(ip - anchor);
+      auto match_length = static_cast<size_t>(match_end - ip) - MIN_MATCH;
+      // token, literal length, literals, offset, match length
+      if (static_cast<size_t>(oend - op) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1) {
+        return 0;
+      }
+      uint8_t *token = op++;
+      *token = static_cast<uint8_t>((literal_length < RUN_MASK ? literal_length : RUN_MASK) << ML_BITS);
+      if (literal_length >= RUN_MASK) {
+        op = WriteLength(op, literal_length - RUN_MASK);
+      }
+      memcpy(op, anchor, literal_length);
+      op += literal_length;
+      auto offset = static_cast<uint16_t>(ip - ref);
+      *op++ = static_cast<uint8_t>(offset);
+      *op++ = static_cast<uint8_t>(offset >> 8);
+      *token |= static_cast<uint8_t>(match_length < ML_MASK ? match_length : ML_MASK);
+      if (match_length >= ML_MASK) {
+        op = WriteLength(op, match_length - ML_MASK);
+      }
+      ip = match_end;
+      anchor = ip;
+    }
+  }
+
+  // The last sequence is literals only.
+  auto literal_length = static_cast<size_t>(iend - anchor);
+  if (static_cast<size_t>(oend - op) < 1 + literal_length / 255 + 1 + literal_length) {
+    return 0;
+  }
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>((literal_length < RUN_MASK ? literal_length : RUN_MASK) << ML_BITS);
+  if (literal_length >= RUN_MASK) {
+    op = WriteLength(op, literal_length - RUN_MASK);
+  }
+  memcpy(op, anchor, literal_length);
+  op += literal_length;
+  return static_cast<int>(op - reinterpret_cast<uint8_t *>(dst));
+}
+
+auto Lz4Codec::Decompress(const char *src, char *dst, int compressed_size, int dst_capacity) -> int {
+  const auto *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *iend = ip + compressed_size;
+  auto *ostart = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *op = ostart;
+  uint8_t *oend = ostart + dst_capacity;
+
+  while (true) {
+    if (ip >= iend) {
+      return -1;
+    }
+    uint8_t token = *ip++;
+    size_t literal_length = token >> ML_BITS;
+    if (literal_length == RUN_MASK && !ReadLength(&ip, iend, &literal_length)) {
+      return -1;
+    }
+    if (literal_length > static_cast<size_t>(iend - ip) || literal_length > static_cast<size_t>(oend - op)) {
+      return -1;
+    }
+    memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == iend) {
+      break;
+    }
+
+    if (iend - ip < 2) {
+      return -1;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - ostart)) {
+      return -1;
+    }
+    size_t match_length = token & ML_MASK;
+    if (match_length == ML_MASK && !ReadLength(&ip, iend, &match_length)) {
+      return -1;
+    }
+    match_length += MIN_MATCH;
+    if (match_length > static_cast<size_t>(oend - op)) {
+      return -1;
+    }
+    const uint8_t *match = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, match, match_length);
+      op += match_length;
+    } else {
+      // The match overlaps the bytes it produces, e.g. a run of one repeated byte.
+      for (size_t i = 0; i < match_length; i++) {
+        *op++ = match[i];
+      }
+    }
+  }
+  return static_cast<int>(op - ostart);
+}
+
+}  // namespace bustub
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -17,33 +18,51 @@
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
 #include "common/rid.h"
 #include "container/hash/extendible_hash_table.h"
 
 namespace bustub {
 
+namespace {
+
+/** Read latch on the header page for the scope of the object; the page is pinned by the table. */
+class HeaderReadLatch {
+ public:
+  explicit HeaderReadLatch(Page *page) : page_(page) { page_->RLatch(); }
+  ~HeaderReadLatch() { page_->RUnlatch(); }
+  DISALLOW_COPY_AND_MOVE(HeaderReadLatch);
+
+  auto Get() const -> const ExtendibleHashTableHeaderPage * {
+    return reinterpret_cast<const ExtendibleHashTableHeaderPage *>(page_->GetData());
+  }
+
+ private:
+  Page *page_;
+};
+
+}  // namespace
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     uint32_t header_depth)
     : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  //  implement me!
-  auto page = buffer_pool_manager_->NewPage(&directory_page_id_);
-  auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
-  dir_page->SetPageId(directory_page_id_);
-  dir_page->IncrGlobalDepth();
-
-  page_id_t bucket_page_id_0, bucket_page_id_1;
-  buffer_pool_manager_->NewPage(&bucket_page_id_0);
-  buffer_pool_manager_->NewPage(&bucket_page_id_1);
-
-  dir_page->SetLocalDepth(0, 1);
-  dir_page->SetLocalDepth(1, 1);
-  dir_page->SetBucketPageId(0, bucket_page_id_0);
-  dir_page->SetBucketPageId(1, bucket_page_id_1);
-
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  buffer_pool_manager_->UnpinPage(bucket_page_id_0, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id_1, false);
+  if (header_depth > HEADER_MAX_DEPTH) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "header depth exceeds HEADER_MAX_DEPTH");
+  }
+  // The header page stays pinned until the destructor, see the class comment.
+  header_page_ = buffer_pool_manager_->NewPage(&header_page_id_);
+  reinterpret_cast<ExtendibleHashTableHeaderPage *>(header_page_->GetData())->Init(header_page_id_, header_depth);
+  directory_mirrors_ = std::make_unique<DirectoryMirror[]>(1 << header_depth);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::~ExtendibleHashTable() {
+  for (page_id_t page_id : retired_pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
 }
 
 /*****************************************************************************
@@ -62,26 +81,153 @@ auto HASH_TABLE_TYPE::Hash(KeyType key) -> uint32_t {
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
+inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t {
   uint32_t directory_index = Hash(key) & dir_page->GetGlobalDepthMask();
   return directory_index;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
+inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t {
   uint32_t directory_index = Hash(key) & dir_page->GetGlobalDepthMask();
   page_id_t page_id = dir_page->GetBucketPageId(directory_index);
   return page_id;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::FetchDirectoryPage() -> HashTableDirectoryPage * {
-  return reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id_)->GetData());
+inline auto HASH_TABLE_TYPE::MirrorOf(uint32_t hash) -> DirectoryMirror & {
+  // The header depth never changes, so the header page is read without its latch.
+  auto header_page = reinterpret_cast<const ExtendibleHashTableHeaderPage *>(header_page_->GetData());
+  return directory_mirrors_[header_page->HashToDirectoryIndex(hash)];
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::ReadMirror(uint32_t hash, page_id_t *bucket_page_id, uint64_t *directory_version) -> bool {
+  DirectoryMirror &mirror = MirrorOf(hash);
+  uint64_t version = mirror.version_.load(std::memory_order_acquire);
+  if (version % 2 == 1) {
+    return false;
+  }
+  if (mirror.page_id_.load(std::memory_order_relaxed) == INVALID_PAGE_ID) {
+    *bucket_page_id = INVALID_PAGE_ID;
+  } else {
+    uint32_t directory_index = hash & mirror.global_depth_mask_.load(std::memory_order_relaxed);
+    *bucket_page_id = mirror.bucket_page_ids_[directory_index].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  *directory_version = version;
+  return mirror.version_.load(std::memory_order_relaxed) == version;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::ReadDirectory(uint32_t hash, uint64_t *directory_version, BasicPageGuard *bucket_pin)
+    -> page_id_t {
+  page_id_t directory_page_id;
+  {
+    HeaderReadLatch header_latch(header_page_);
+    directory_page_id = header_latch.Get()->GetDirectoryPageId(header_latch.Get()->HashToDirectoryIndex(hash));
+  }
+  if (directory_page_id == INVALID_PAGE_ID) {
+    return INVALID_PAGE_ID;
+  }
+  ReadPageGuard dir_guard = buffer_pool_manager_->FetchPageRead(directory_page_id);
+  if (!dir_guard) {
+    return INVALID_PAGE_ID;
+  }
+  auto dir_page = dir_guard.As<HashTableDirectoryPage>();
+  *directory_version = MirrorOf(hash).version_;
+  page_id_t bucket_page_id = dir_page->GetBucketPageId(hash & dir_page->GetGlobalDepthMask());
+  if (bucket_pin != nullptr) {
+    *bucket_pin = buffer_pool_manager_->FetchPageBasic(bucket_page_id);
+  }
+  return bucket_page_id;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::PinBucketPage(uint32_t hash, uint64_t *directory_version) -> BasicPageGuard {
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  if (optimistic_reads_ && ReadMirror(hash, &bucket_page_id, directory_version)) {
+    if (bucket_page_id == INVALID_PAGE_ID) {
+      return {};
+    }
+    BasicPageGuard bucket_pin = PinMirroredBucket(hash, bucket_page_id, *directory_version);
+    if (bucket_pin) {
+      return bucket_pin;
+    }
+  }
+
+  BasicPageGuard bucket_pin;
+  ReadDirectory(hash, directory_version, &bucket_pin);
+  return bucket_pin;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::PinMirroredBucket(uint32_t hash, page_id_t bucket_page_id, uint64_t directory_version)
+    -> BasicPageGuard {
+  // The bucket may be merged away and deleted before it is pinned, and its id reused for another page, which must be
+  // neither latched nor read as a bucket. A merge deletes a bucket only after it published the directory without it,
+  // so a bucket pinned while the version is unchanged stays a bucket page until the pin is released.
+  BasicPageGuard bucket_pin = buffer_pool_manager_->FetchPageBasic(bucket_page_id);
+  if (bucket_pin && MirrorOf(hash).version_.load() != directory_version) {
+    bucket_pin.Drop();
+  }
+  return bucket_pin;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::IsBucketOf(uint32_t hash, page_id_t bucket_page_id, uint64_t directory_version) -> bool {
+  if (MirrorOf(hash).version_ == directory_version) {
+    return true;
+  }
+  uint64_t version = 0;
+  return ReadDirectory(hash, &version, nullptr) == bucket_page_id;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::CreateDirectory(uint32_t hash) -> bool {
+  DirectoryMirror &mirror = MirrorOf(hash);
+  if (mirror.page_id_.load(std::memory_order_acquire) != INVALID_PAGE_ID) {
+    return true;
+  }
+  WritePageGuard header_guard = buffer_pool_manager_->FetchPageWrite(header_page_id_);
+  if (!header_guard) {
+    return false;
+  }
+  auto header_page = header_guard.AsMut<ExtendibleHashTableHeaderPage>();
+  uint32_t directory_idx = header_page->HashToDirectoryIndex(hash);
+  // Another insert may have created the directory while this one waited for the header latch.
+  if (header_page->GetDirectoryPageId(directory_idx) != INVALID_PAGE_ID) {
+    return true;
+  }
+
+  page_id_t directory_page_id = INVALID_PAGE_ID;
+  WritePageGuard dir_guard = buffer_pool_manager_->NewPageGuarded(&directory_page_id).UpgradeWrite();
+  if (!dir_guard) {
+    return false;
+  }
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  if (!buffer_pool_manager_->NewPageGuarded(&bucket_page_id)) {
+    dir_guard.Drop();
+    buffer_pool_manager_->DeletePage(directory_page_id);
+    return false;
+  }
+  auto dir_page = dir_guard.AsMut<HashTableDirectoryPage>();
+  dir_page->SetPageId(directory_page_id);
+  dir_page->SetLocalDepth(0, 0);
+  dir_page->SetBucketPageId(0, bucket_page_id);
+  PublishDirectory(&mirror, dir_page);
+  header_page->SetDirectoryPageId(directory_idx, directory_page_id);
+  mirror.page_id_.store(directory_page_id, std::memory_order_release);
+  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
-  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->FetchPage(bucket_page_id)->GetData());
+void HASH_TABLE_TYPE::PublishDirectory(DirectoryMirror *mirror, const HashTableDirectoryPage *dir_page) {
+  mirror->version_.fetch_add(1);
+  mirror->global_depth_mask_.store(dir_page->GetGlobalDepthMask(), std::memory_order_relaxed);
+  for (uint32_t i = 0; i < dir_page->Size(); i++) {
+    mirror->bucket_page_ids_[i].store(dir_page->GetBucketPageId(i), std::memory_order_relaxed);
+  }
+  mirror->version_.fetch_add(1, std::memory_order_release);
 }
 
 /*****************************************************************************
@@ -89,18 +235,89 @@ auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BU
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage * dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE * bucket_page = FetchBucketPage(bucket_page_id);
-  auto bucket_page_latch = reinterpret_cast<Page *>(bucket_page);
-  bucket_page_latch->RLatch();
-  bool success = bucket_page->GetValue(key, comparator_, result);
-  bucket_page_latch->RUnlatch();
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  table_latch_.RUnlock();
-  return success;
+  uint32_t hash = Hash(key);
+  while (true) {
+    uint64_t directory_version = 0;
+    ReadPageGuard bucket_guard = PinBucketPage(hash, &directory_version).UpgradeRead();
+    if (!bucket_guard) {
+      return false;
+    }
+    // A split may have moved the key to a new bucket before the bucket was latched.
+    if (IsBucketOf(hash, bucket_guard.PageId(), directory_version)) {
+      return bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->GetValue(key, comparator_, result);
+    }
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                                std::vector<std::vector<ValueType>> *results) -> size_t {
+  results->assign(keys.size(), {});
+  std::vector<uint32_t> hashes(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    hashes[i] = Hash(keys[i]);
+  }
+
+  // Keys whose bucket split since the directory was read, or that found no bucket or frame, are looked up one by one
+  // at the end.
+  std::vector<uint32_t> retries;
+  // (bucket page id, key index) of every key, sorted so that the keys of a bucket are next to each other.
+  std::vector<std::pair<page_id_t, uint32_t>> lookups;
+  lookups.reserve(keys.size());
+  std::vector<uint64_t> directory_versions(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    page_id_t bucket_page_id = INVALID_PAGE_ID;
+    if (!optimistic_reads_ || !ReadMirror(hashes[i], &bucket_page_id, &directory_versions[i])) {
+      bucket_page_id = ReadDirectory(hashes[i], &directory_versions[i], nullptr);
+    }
+    if (bucket_page_id == INVALID_PAGE_ID) {
+      retries.push_back(i);
+    } else {
+      lookups.emplace_back(bucket_page_id, static_cast<uint32_t>(i));
+    }
+  }
+  std::sort(lookups.begin(), lookups.end());
+
+  size_t num_found = 0;
+  // A bucket is pinned through the first key looked up in it; keys whose bucket cannot be pinned are retried.
+  auto pin_bucket = [&](size_t lookup) {
+    uint32_t key_index = lookups[lookup].second;
+    return PinMirroredBucket(hashes[key_index], lookups[lookup].first, directory_versions[key_index]);
+  };
+  BasicPageGuard next_bucket_pin;
+  if (!lookups.empty()) {
+    next_bucket_pin = pin_bucket(0);
+  }
+  for (size_t begin = 0, end = 0; begin < lookups.size(); begin = end) {
+    while (end < lookups.size() && lookups[end].first == lookups[begin].first) {
+      end++;
+    }
+    ReadPageGuard bucket_guard = next_bucket_pin.UpgradeRead();
+    // The next bucket is pinned before this one is probed, so that its bitmaps are in the cache when it is its turn.
+    if (end < lookups.size()) {
+      next_bucket_pin = pin_bucket(end);
+      if (next_bucket_pin) {
+        next_bucket_pin.As<HASH_TABLE_BUCKET_TYPE>()->Prefetch();
+      }
+    }
+    for (size_t i = begin; i < end; i++) {
+      uint32_t key_index = lookups[i].second;
+      if (!bucket_guard || !IsBucketOf(hashes[key_index], bucket_guard.PageId(), directory_versions[key_index])) {
+        retries.push_back(key_index);
+        continue;
+      }
+      if (bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->GetValue(keys[key_index], comparator_, &(*results)[key_index])) {
+        num_found++;
+      }
+    }
+  }
+
+  for (uint32_t key_index : retries) {
+    if (GetValue(transaction, keys[key_index], &(*results)[key_index])) {
+      num_found++;
+    }
+  }
+  return num_found;
 }
 
 /*****************************************************************************
@@ -108,85 +325,92 @@ auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage * dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE * bucket_page = FetchBucketPage(bucket_page_id);
-  auto bucket_page_latch = reinterpret_cast<Page *>(bucket_page);
-  
-  bucket_page_latch->RLatch();
-  if(bucket_page->IsFull()) {
-    bucket_page_latch->RUnlatch();
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    table_latch_.RUnlock();
-    return SplitInsert(transaction, key, value);
-  }
-  bucket_page_latch->RUnlatch();
-
-  bucket_page_latch->WLatch();
-  bool success = bucket_page->Insert(key, value, comparator_);
-  bucket_page_latch->WUnlatch();
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  table_latch_.RUnlock();
-  return success;
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  table_latch_.WLock();
-  HashTableDirectoryPage * dir_page = FetchDirectoryPage();
-  uint32_t dir_index = KeyToDirectoryIndex(key, dir_page);
-  page_id_t old_bucket_page_id = KeyToPageId(key, dir_page);
-
-  if(dir_page->GetGlobalDepth() == dir_page->GetLocalDepth(dir_index)) {
-    uint32_t num_buckets = dir_page->Size();
-    if(num_buckets == DIRECTORY_ARRAY_SIZE) {
-      table_latch_.WUnlock();
+  uint32_t hash = Hash(key);
+  if (!CreateDirectory(hash)) {
+    return false;
+  }
+  while (true) {
+    uint64_t directory_version = 0;
+    WritePageGuard bucket_guard = PinBucketPage(hash, &directory_version).UpgradeWrite();
+    if (!bucket_guard) {
       return false;
     }
-    
-    for(uint32_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
-      uint32_t new_bucket_index = bucket_index + ( 1 << dir_page->GetGlobalDepth() );
-      dir_page->SetLocalDepth(new_bucket_index, dir_page->GetLocalDepth(bucket_index));
-      dir_page->SetBucketPageId(new_bucket_index, dir_page->GetBucketPageId(bucket_index));
+    if (!IsBucketOf(hash, bucket_guard.PageId(), directory_version)) {
+      continue;
+    }
+    if (!bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsFull()) {
+      return bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>()->Insert(key, value, comparator_);
+    }
+    if (!SplitBucket(&bucket_guard, key)) {
+      return false;
     }
-    dir_page->IncrGlobalDepth();
+    // Retry: the bucket of the key may still be full if no key moved.
   }
+}
 
-
-  HASH_TABLE_BUCKET_TYPE * old_bucket_page = FetchBucketPage(old_bucket_page_id);
-
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::SplitBucket(WritePageGuard *bucket_guard, const KeyType &key) -> bool {
+  // The new bucket is latched before it is published in the directory, so nobody reads it before the keys have moved.
   page_id_t new_bucket_page_id = INVALID_PAGE_ID;
-  auto new_bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(&new_bucket_page_id)->GetData());
-  dir_page->IncrLocalDepth(dir_index);
+  WritePageGuard new_bucket_guard = buffer_pool_manager_->NewPageGuarded(&new_bucket_page_id).UpgradeWrite();
+  if (!new_bucket_guard) {
+    return false;
+  }
+  page_id_t old_bucket_page_id = bucket_guard->PageId();
+  DirectoryMirror &mirror = MirrorOf(Hash(key));
+  uint32_t local_mask;
+  {
+    WritePageGuard dir_guard = buffer_pool_manager_->FetchPageWrite(mirror.page_id_);
+    if (!dir_guard) {
+      new_bucket_guard.Drop();
+      buffer_pool_manager_->DeletePage(new_bucket_page_id);
+      return false;
+    }
+    auto dir_page = dir_guard.AsMut<HashTableDirectoryPage>();
+    uint32_t dir_index = KeyToDirectoryIndex(key, dir_page);
+
+    if (dir_page->GetGlobalDepth() == dir_page->GetLocalDepth(dir_index)) {
+      uint32_t num_buckets = dir_page->Size();
+      if (num_buckets == DIRECTORY_ARRAY_SIZE) {
+        dir_guard.Drop();
+        new_bucket_guard.Drop();
+        buffer_pool_manager_->DeletePage(new_bucket_page_id);
+        return false;
+      }
 
-  auto local_mask = dir_page->GetLocalDepthMask(dir_index);
+      for (uint32_t bucket_index = 0; bucket_index < num_buckets; bucket_index++) {
+        uint32_t new_bucket_index = bucket_index + (1 << dir_page->GetGlobalDepth());
+        dir_page->SetLocalDepth(new_bucket_index, dir_page->GetLocalDepth(bucket_index));
+        dir_page->SetBucketPageId(new_bucket_index, dir_page->GetBucketPageId(bucket_index));
+      }
+      dir_page->IncrGlobalDepth();
+      dir_index = KeyToDirectoryIndex(key, dir_page);
+    }
 
-  for(uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if(i!=dir_index&&dir_page->GetBucketPageId(i)==old_bucket_page_id) {
-      dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(dir_index));
-      if((local_mask & i) != (local_mask & dir_index))
-        dir_page->SetBucketPageId(i, new_bucket_page_id);
+    dir_page->IncrLocalDepth(dir_index);
+    local_mask = dir_page->GetLocalDepthMask(dir_index);
+    for (uint32_t i = 0; i < dir_page->Size(); i++) {
+      if (i != dir_index && dir_page->GetBucketPageId(i) == old_bucket_page_id) {
+        dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(dir_index));
+        if ((local_mask & i) != (local_mask & dir_index)) {
+          dir_page->SetBucketPageId(i, new_bucket_page_id);
+        }
+      }
     }
+    PublishDirectory(&mirror, dir_page);
   }
 
-
-  for(uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    auto new_index = KeyToDirectoryIndex(old_bucket_page->KeyAt(i), dir_page);
-    if((local_mask & new_index) != (local_mask & dir_index)) {
+  // Only the two buckets are latched from here on. The key stays with the old bucket, its split image moves.
+  auto old_bucket_page = bucket_guard->AsMut<HASH_TABLE_BUCKET_TYPE>();
+  auto new_bucket_page = new_bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
+  uint32_t old_bits = Hash(key) & local_mask;
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (old_bucket_page->IsReadable(i) && (Hash(old_bucket_page->KeyAt(i)) & local_mask) != old_bits) {
       new_bucket_page->Insert(old_bucket_page->KeyAt(i), old_bucket_page->ValueAt(i), comparator_);
       old_bucket_page->SetReadable(i, false);
     }
   }
-
-
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  buffer_pool_manager_->UnpinPage(old_bucket_page_id, true);
-  buffer_pool_manager_->UnpinPage(new_bucket_page_id, true);
-  table_latch_.WUnlock();
-  return Insert(transaction, key, value);
+  return true;
 }
 
 /*****************************************************************************
@@ -194,69 +418,119 @@ auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage * dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE * bucket_page = FetchBucketPage(bucket_page_id);
-  auto bucket_page_latch = reinterpret_cast<Page *>(bucket_page);
-  bucket_page_latch->WLatch();
-  bool success = bucket_page->Remove(key, value, comparator_);
-  bucket_page_latch->WUnlatch();
-  table_latch_.RUnlock();
-
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-
-  if(success && bucket_page->IsEmpty())
-    Merge(transaction, key, value);
+  bool success = false;
+  bool is_empty = false;
+  uint32_t hash = Hash(key);
+  while (true) {
+    uint64_t directory_version = 0;
+    WritePageGuard bucket_guard = PinBucketPage(hash, &directory_version).UpgradeWrite();
+    if (!bucket_guard) {
+      return false;
+    }
+    if (!IsBucketOf(hash, bucket_guard.PageId(), directory_version)) {
+      continue;
+    }
+    auto bucket_page = bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
+    success = bucket_page->Remove(key, value, comparator_);
+    is_empty = bucket_page->IsEmpty();
+    break;
+  }
 
+  if (success && is_empty) {
+    Merge(transaction, key, value);
+  }
   return success;
 }
-
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.WLock();
-  HashTableDirectoryPage * dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE * bucket_page = FetchBucketPage(bucket_page_id);
-
-  
-  if(!bucket_page->IsEmpty()) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    table_latch_.WUnlock();
+  // The bucket was found, so its directory exists.
+  DirectoryMirror &mirror = MirrorOf(Hash(key));
+  BasicPageGuard bucket_pin;
+  BasicPageGuard sibling_pin;
+  {
+    ReadPageGuard dir_guard = buffer_pool_manager_->FetchPageRead(mirror.page_id_);
+    if (!dir_guard) {
+      return;
+    }
+    auto dir_page = dir_guard.As<HashTableDirectoryPage>();
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+    uint32_t sibling_bucket_idx = dir_page->GetSplitImageIndex(bucket_idx);
+    if (dir_page->GetLocalDepth(bucket_idx) == 0 ||
+        dir_page->GetLocalDepth(bucket_idx) != dir_page->GetLocalDepth(sibling_bucket_idx)) {
+      return;
+    }
+    bucket_pin = buffer_pool_manager_->FetchPageBasic(dir_page->GetBucketPageId(bucket_idx));
+    sibling_pin = buffer_pool_manager_->FetchPageBasic(dir_page->GetBucketPageId(sibling_bucket_idx));
+  }
+  if (!bucket_pin || !sibling_pin || bucket_pin.PageId() == sibling_pin.PageId()) {
+    return;
+  }
+  page_id_t bucket_page_id = bucket_pin.PageId();
+  page_id_t sibling_page_id = sibling_pin.PageId();
+
+  // Latch the two buckets in page id order, so that two merges of the same pair cannot deadlock.
+  WritePageGuard bucket_guard;
+  WritePageGuard sibling_guard;
+  if (bucket_page_id < sibling_page_id) {
+    bucket_guard = bucket_pin.UpgradeWrite();
+    sibling_guard = sibling_pin.UpgradeWrite();
+  } else {
+    sibling_guard = sibling_pin.UpgradeWrite();
+    bucket_guard = bucket_pin.UpgradeWrite();
+  }
+  if (!bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsEmpty()) {
     return;
   }
 
-  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
-  uint32_t sibling_bucket_idx = dir_page->GetSplitImageIndex(bucket_idx);
-  page_id_t sibling_page_id = dir_page->GetBucketPageId(sibling_bucket_idx);
-  
-  if(bucket_page_id != sibling_page_id && dir_page->GetLocalDepth(bucket_idx) == dir_page->GetLocalDepth(sibling_bucket_idx)
-                                        && dir_page->GetLocalDepth(bucket_idx) > 0) {
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->DeletePage(bucket_page_id);
+  {
+    WritePageGuard dir_guard = buffer_pool_manager_->FetchPageWrite(mirror.page_id_);
+    if (!dir_guard) {
+      return;
+    }
+    auto dir_page = dir_guard.AsMut<HashTableDirectoryPage>();
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+    uint32_t sibling_bucket_idx = dir_page->GetSplitImageIndex(bucket_idx);
+    // Splits and merges between the pinning and the latching may have changed the pair.
+    if (dir_page->GetBucketPageId(bucket_idx) != bucket_page_id ||
+        dir_page->GetBucketPageId(sibling_bucket_idx) != sibling_page_id || dir_page->GetLocalDepth(bucket_idx) == 0 ||
+        dir_page->GetLocalDepth(bucket_idx) != dir_page->GetLocalDepth(sibling_bucket_idx)) {
+      return;
+    }
 
-    for(uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-      if(dir_page->GetBucketPageId(i)==bucket_page_id) {
+    for (uint32_t i = 0; i < dir_page->Size(); i++) {
+      if (dir_page->GetBucketPageId(i) == bucket_page_id) {
         dir_page->DecrLocalDepth(i);
         dir_page->SetBucketPageId(i, sibling_page_id);
-      }
-      else if(dir_page->GetBucketPageId(i)==sibling_page_id)
+      } else if (dir_page->GetBucketPageId(i) == sibling_page_id) {
         dir_page->DecrLocalDepth(i);
+      }
     }
 
+    while (dir_page->CanShrink() && dir_page->GetGlobalDepth() > 0) {
+      dir_page->DecrGlobalDepth();
+    }
+    PublishDirectory(&mirror, dir_page);
   }
 
-  while(dir_page->CanShrink() && dir_page->GetGlobalDepth() > 1) {
-    dir_page->DecrGlobalDepth();
+  // The bucket is no longer in the directory, so nobody pins it anew. Threads that pinned it before fail to validate
+  // it once they latch it; while they hold their pins, the page cannot be deleted and waits for a later merge.
+  bucket_guard.Drop();
+  sibling_guard.Drop();
+  std::vector<page_id_t> retired_pages;
+  {
+    std::scoped_lock latch(retired_latch_);
+    retired_pages_.push_back(bucket_page_id);
+    retired_pages.swap(retired_pages_);
+  }
+  for (page_id_t page_id : retired_pages) {
+    if (!buffer_pool_manager_->DeletePage(page_id)) {
+      std::scoped_lock latch(retired_latch_);
+      retired_pages_.push_back(page_id);
+    }
   }
-
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  table_latch_.WUnlock();
 }
 
 /*****************************************************************************
@@ -264,11 +538,15 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetGlobalDepth() -> uint32_t {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  HeaderReadLatch header_latch(header_page_);
+  uint32_t global_depth = 0;
+  for (uint32_t i = 0; i < header_latch.Get()->Size(); i++) {
+    page_id_t directory_page_id = header_latch.Get()->GetDirectoryPageId(i);
+    if (directory_page_id != INVALID_PAGE_ID) {
+      ReadPageGuard dir_guard = buffer_pool_manager_->FetchPageRead(directory_page_id);
+      global_depth = std::max(global_depth, dir_guard.As<HashTableDirectoryPage>()->GetGlobalDepth());
+    }
+  }
   return global_depth;
 }
 
@@ -277,11 +555,15 @@ auto HASH_TABLE_TYPE::GetGlobalDepth() -> uint32_t {
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  HeaderReadLatch header_latch(header_page_);
+  for (uint32_t i = 0; i < header_latch.Get()->Size(); i++) {
+    page_id_t directory_page_id = header_latch.Get()->GetDirectoryPageId(i);
+    if (directory_page_id != INVALID_PAGE_ID) {
+      ReadPageGuard dir_guard = buffer_pool_manager_->FetchPageRead(directory_page_id);
+      // VerifyIntegrity only reads the directory, it is just not declared const.
+      const_cast<HashTableDirectoryPage *>(dir_guard.As<HashTableDirectoryPage>())->VerifyIntegrity();
+    }
+  }
 }
 
 /*****************************************************************************
@@ -12,14 +12,87 @@
 
 #include "execution/executors/nested_index_join_executor.h"
 
+#include "execution/expressions/column_value_expression.h"
+
 namespace bustub {
 
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {
+  auto *catalog = exec_ctx_->GetCatalog();
+  inner_table_info_ = catalog->GetTable(plan_->GetInnerTableOid());
+  index_info_ = catalog->GetIndex(plan_->GetIndexName(), inner_table_info_->name_);
+  // The predicate compares an outer column with the indexed inner column; find the outer one.
+  outer_key_expr_ = plan_->Predicate()->GetChildAt(0);
+  for (const auto *child : plan_->Predicate()->GetChildren()) {
+    const auto *column = dynamic_cast<const ColumnValueExpression *>(child);
+    if (column != nullptr && column->GetTupleIdx() == 0) {
+      outer_key_expr_ = child;
+      break;
+    }
+  }
+}
+
+void NestIndexJoinExecutor::Init() {
+  child_executor_->Init();
+  outer_tuples_.clear();
+  inner_rids_.clear();
+  outer_idx_ = 0;
+  rid_idx_ = 0;
+}
+
+auto NestIndexJoinExecutor::NextBatch() -> bool {
+  outer_tuples_.clear();
+  outer_idx_ = 0;
+  rid_idx_ = 0;
+  Tuple outer_tuple;
+  RID outer_rid;
+  while (outer_tuples_.size() < BATCH_SIZE && child_executor_->Next(&outer_tuple, &outer_rid)) {
+    outer_tuples_.push_back(outer_tuple);
+  }
+  if (outer_tuples_.empty()) {
+    return false;
+  }
 
-void NestIndexJoinExecutor::Init() {}
+  std::vector<Tuple> keys;
+  keys.reserve(outer_tuples_.size());
+  for (const auto &tuple : outer_tuples_) {
+    Value key = outer_key_expr_->Evaluate(&tuple, plan_->OuterTableSchema());
+    keys.emplace_back(std::vector<Value>{key}, &index_info_->key_schema_);
+  }
+  index_info_->index_->ScanKeys(keys, &inner_rids_, exec_ctx_->GetTransaction());
+  return true;
+}
 
-auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (true) {
+    for (; outer_idx_ < outer_tuples_.size(); outer_idx_++, rid_idx_ = 0) {
+      const Tuple &outer_tuple = outer_tuples_[outer_idx_];
+      const auto &rids = inner_rids_[outer_idx_];
+      while (rid_idx_ < rids.size()) {
+        Tuple inner_tuple;
+        if (!inner_table_info_->table_->GetTuple(rids[rid_idx_++], &inner_tuple, exec_ctx_->GetTransaction())) {
+          continue;
+        }
+        if (!plan_->Predicate()
+                 ->EvaluateJoin(&outer_tuple, plan_->OuterTableSchema(), &inner_tuple, plan_->InnerTableSchema())
+                 .GetAs<bool>()) {
+          continue;
+        }
+        std::vector<Value> values;
+        values.reserve(GetOutputSchema()->GetColumnCount());
+        for (const auto &col : GetOutputSchema()->GetColumns()) {
+          values.emplace_back(col.GetExpr()->EvaluateJoin(&outer_tuple, plan_->OuterTableSchema(), &inner_tuple,
+                                                          plan_->InnerTableSchema()));
+        }
+        *tuple = Tuple(values, GetOutputSchema());
+        return true;
+      }
+    }
+    if (!NextBatch()) {
+      return false;
+    }
+  }
+}
 
 }  // namespace bustub
@@ -12,14 +12,17 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -30,6 +33,8 @@ class BufferPoolManager {
  public:
   enum class CallbackType { BEFORE, AFTER };
   using bufferpool_callback_fn = void (*)(enum CallbackType, const page_id_t page_id);
+  /** Reads the id of the page that follows a (read-latched) page in a chain, INVALID_PAGE_ID at the end. */
+  using next_page_fn = std::function<page_id_t(Page *page)>;
 
   BufferPoolManager() = default;
   /**
@@ -84,9 +89,78 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetch a page and wrap the pin in a guard, which unpins it when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  auto FetchPageBasic(page_id_t page_id) -> BasicPageGuard { return BasicPageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Fetch a page and latch it in read mode. The guard releases the latch and the pin when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  auto FetchPageRead(page_id_t page_id) -> ReadPageGuard { return ReadPageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Fetch a page and latch it in write mode. The guard releases the latch and the pin when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard { return WritePageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Create a new page and wrap the pin in a guard. A new page is dirty, so it is written back once evicted.
+   * @param[out] page_id id of created page
+   * @return a guard holding the page, empty if no new page could be created
+   */
+  auto NewPageGuarded(page_id_t *page_id) -> BasicPageGuard { return BasicPageGuard(this, NewPage(page_id)); }
+
+  /**
+   * Unpin a page that the caller holds a pin on, given the page rather than its id. Page guards unpin through here.
+   * Buffer pools that know the frame from the page override it to skip the page table lookup of UnpinPage.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  virtual auto UnpinFrame(Page *page, bool is_dirty) -> bool { return UnpinPgImp(page->GetPageId(), is_dirty); }
+
+  /**
+   * Fetch a page on behalf of read-ahead. The page is pinned as by FetchPage, but the fetch is not a reference to the
+   * page: replacement policies that count accesses (LRU-K) do not see it, so a scan that reads ahead still touches
+   * every page once. The pin is dropped with UnpinReadAheadPage.
+   * @param page_id id of page to be fetched
+   * @return the requested page, nullptr if it could not be fetched
+   */
+  virtual auto FetchPageForReadAhead(page_id_t page_id) -> Page * { return FetchPage(page_id); }
+
+  /**
+   * Drop the pin taken by FetchPageForReadAhead.
+   * @param page the page that was read ahead
+   */
+  virtual void UnpinReadAheadPage(Page *page) { UnpinFrame(page, false); }
+
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
+  /**
+   * Hint that pages will be fetched soon. The pages are read into the buffer pool in the background and left
+   * unpinned; the call returns immediately. Buffer pools that cannot read ahead ignore the hint.
+   * @param page_ids ids of the pages to read ahead
+   */
+  virtual void PrefetchPages(const std::vector<page_id_t> &page_ids) {}
+
+  /**
+   * Hint that a chain of linked pages will be fetched soon, e.g. the pages of a table heap. Each page is read in the
+   * background and next_page is called on it to find the page that follows, so the chain is followed without the
+   * caller having to wait for any of the reads.
+   * @param page_id id of the first page of the chain
+   * @param num_pages maximum number of pages to read ahead
+   * @param next_page returns the id of the page following a page in the chain
+   */
+  virtual void PrefetchChain(page_id_t page_id, size_t num_pages, next_page_fn next_page) {}
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -12,12 +12,21 @@
 
 #pragma once
 
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
 #include <list>
-#include <mutex>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
-#include "buffer/lru_replacer.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/prefetcher.h"
+#include "buffer/replacer_factory.h"
+#include "common/rwlatch.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -34,8 +43,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -43,26 +54,118 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
+   * @param numa_node the NUMA node to allocate the frames on, -1 to leave placement to the OS
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU, int numa_node = -1);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
    */
   ~BufferPoolManagerInstance() override;
 
-  /** @return size of the buffer pool */
-  auto GetPoolSize() -> size_t override { return pool_size_; }
+  /**
+   * Unpin a page by its frame, which is its position in the frame array, so neither the page table nor its latch is
+   * touched. The replacer may see the unpin after a later pin of the frame; eviction tolerates that, see TryEvictFrame.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinFrame(Page *page, bool is_dirty) -> bool override;
+
+  auto FetchPageForReadAhead(page_id_t page_id) -> Page * override { return TryFetchPage(page_id, false); }
+
+  void UnpinReadAheadPage(Page *page) override;
+
+  /**
+   * Create a new page like NewPage, with a frame wait timeout of its own.
+   * @param[out] page_id id of created page
+   * @param frame_wait_timeout how long to wait for a frame if every frame is pinned, 0 to fail at once
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto TryNewPage(page_id_t *page_id, std::chrono::milliseconds frame_wait_timeout) -> Page *;
+
+  /**
+   * Let FetchPage and NewPage wait for a frame when every frame is pinned, instead of returning nullptr at once. They
+   * wait until an unpin or a deleted page frees a frame, or until the timeout. Waiting is off (timeout 0) by default.
+   * @param timeout the longest time a request waits for a frame
+   */
+  void SetFrameWaitTimeout(std::chrono::milliseconds timeout) { frame_wait_timeout_ = timeout; }
+
+  /** @return number of frames the buffer pool may currently use, see SetFrameBudget */
+  auto GetPoolSize() -> size_t override { return num_frames_; }
+
+  /**
+   * Grow or shrink the number of frames in use, between 0 and the pool size given at construction. Frames given up
+   * are evicted (written back if dirty) and their memory is returned to the OS. Shrinking stops early if the remaining
+   * frames are pinned.
+   * @param num_frames the number of frames to use
+   * @return the number of frames now in use
+   */
+  auto SetFrameBudget(size_t num_frames) -> size_t;
 
   /** @return pointer to all the pages in the buffer pool */
   auto GetPages() -> Page * { return pages_; }
 
+  void PrefetchPages(const std::vector<page_id_t> &page_ids) override { prefetcher_->PrefetchPages(page_ids); }
+
+  void PrefetchChain(page_id_t page_id, size_t num_pages, next_page_fn next_page) override {
+    prefetcher_->PrefetchChain(page_id, num_pages, std::move(next_page));
+  }
+
+  /** @return the number of pages fetched by the prefetcher */
+  auto GetPrefetchCount() const -> uint64_t { return prefetcher_->GetPrefetchCount(); }
+
+  /**
+   * Start the background writer. It wakes up every interval (or sooner when a miss runs into a dirty victim) and
+   * writes back unpinned dirty pages until at least clean_frame_target frames are free or clean, so that misses can
+   * usually evict without waiting on a write.
+   * @param clean_frame_target number of evictable clean frames to keep ready
+   * @param interval how long the writer sleeps between rounds
+   */
+  void RunBackgroundWriter(size_t clean_frame_target,
+                           std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+  /** Stop and join the background writer, if it is running. */
+  void StopBackgroundWriter();
+
+  /**
+   * Write back the dirty pages of several instances as one group, as a checkpoint does. Clean pages are skipped. The
+   * pages are sorted by page id and written in batches through DiskManager::SubmitRequests, so runs of adjacent pages
+   * become single vectored writes, and the log is forced once per batch rather than once per page. No instance latch
+   * is held during the I/O: every page is only pinned while its batch is written. With the double-write buffer of the
+   * disk manager on, a crash cannot tear the pages of a batch, see DiskManager::SetDoubleWrite.
+   * @param instances the instances to flush; they must share one disk manager and one log manager
+   */
+  static void FlushDirtyPages(const std::vector<BufferPoolManagerInstance *> &instances);
+
+  /** @return the NUMA node the frames were allocated on, -1 if placement was left to the OS */
+  auto GetNumaNode() const -> int { return numa_node_; }
+
+  /** @return the event counters of the instance, read without any latch */
+  auto GetCounters() const -> const BufferPoolCounters & { return counters_; }
+
+  /**
+   * Take a snapshot of the counters and of the frames: how many hold a page, how many of those are dirty, and how
+   * they are pinned. The frames are read without latches, so the frame state is approximate under concurrent use.
+   * @return the statistics of the instance
+   */
+  auto GetStats() const -> BufferPoolStats;
+
+  /**
+   * Turn the latency histograms of FetchPage, NewPage and FlushPage on or off. They are off by default, since they
+   * read the clock twice per operation.
+   * @param enabled true to record latencies
+   */
+  void SetLatencyTracking(bool enabled) { track_latency_ = enabled; }
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
-   * @return the requested page
+   * @return the requested page, or nullptr if no frame is free or the page has been deleted
    */
   auto FetchPgImp(page_id_t page_id) -> Page * override;
 
@@ -91,35 +194,160 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
-   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   * @return false if the page was never allocated or exists but could not be deleted, true if the page was only on
+   * disk or deletion succeeded
    */
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes all the dirty pages in the buffer pool to disk, see FlushDirtyPages.
    */
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
+   * Allocate a page on disk. Deleted pages of this instance are reused before the file is extended.
    * @return the id of the allocated page
    */
   auto AllocatePage() -> page_id_t;
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, so that AllocatePage can reuse it.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
+  void DeallocatePage(page_id_t page_id) { disk_manager_->DeallocatePage(page_id); }
+
+  /**
+   * One partition of the page table. Lookups take the partition latch in read mode, so buffer pool hits on pages in
+   * different partitions (or the same partition) never serialize on latch_. Mappings are only added or removed with
+   * the partition latch held in write mode, and only by threads that also hold latch_.
+   */
+  struct PageTablePartition {
+    ReaderWriterLatch latch_;
+    std::unordered_map<page_id_t, frame_id_t> table_;
+  };
+
+  /**
+   * @param page_id id of a page owned by this BPI
+   * @return the page table partition responsible for page_id
+   */
+  auto GetPageTablePartition(page_id_t page_id) -> PageTablePartition & {
+    return page_table_[(page_id / num_instances_) % PAGE_TABLE_PARTITIONS];
   }
 
+  /**
+   * Acquire latch_, accounting the time spent waiting for it if it is contended.
+   * @return the held latch
+   */
+  auto LockLatch() -> std::unique_lock<std::mutex>;
+
+  /**
+   * Fetch a page, through the page table if it is resident and from disk otherwise.
+   * @param page_id id of page to be fetched
+   * @param referenced false if the fetch is not an access to the page (read-ahead), so the replacer must not see it
+   * @return the requested page, nullptr if it could not be fetched
+   */
+  auto TryFetchPage(page_id_t page_id, bool referenced) -> Page *;
+
+  /**
+   * Pin the requested page if it is resident, without taking latch_.
+   * @param page_id id of the page to pin
+   * @param referenced false to leave the replacer alone, as PinForWriteBack does
+   * @return the pinned page, or nullptr if the page is not in the buffer pool
+   */
+  auto PinResidentPage(page_id_t page_id, bool referenced = true) -> Page *;
+
+  /**
+   * Block until the read that brings a page into a frame has completed. The caller must hold a pin on the page. This
+   * does not wait on the page latch, so that pinning a page never waits for a thread that holds its latch, e.g. one
+   * that latched the page right after reading it in.
+   * @param frame_id the frame holding the page
+   * @return false if the read failed verification; the caller then drops its pin with ReleaseFailedFrame
+   */
+  auto WaitUntilLoaded(frame_id_t frame_id) -> bool;
+
+  /**
+   * Drop a pin on a frame whose read failed verification. The page is no longer in the page table, so the last pin
+   * puts the frame back on the free list.
+   * @param page the page in the frame
+   */
+  void ReleaseFailedFrame(Page *page);
+
+  /**
+   * Find a frame that can hold a new page, taking it from the free list first and from the replacer otherwise.
+   * An evicted page is removed from the page table and written back if it is dirty. Must be called with latch_ held.
+   * @param[out] frame_id id of the frame that is now unused
+   * @return false if every frame is pinned, true otherwise
+   */
+  auto AcquireFrame(frame_id_t *frame_id) -> bool;
+
+  /**
+   * Find a frame like AcquireFrame; if every frame is pinned, wait for one until the timeout. latch_ is released while
+   * waiting, so a fetch also stops waiting when another thread reads its page in meanwhile.
+   * @param latch the held latch_
+   * @param[out] frame_id id of the frame that is now unused
+   * @param timeout how long to wait, 0 not to wait
+   * @param page_id the page being fetched, INVALID_PAGE_ID for a new page
+   * @return false if there is no frame, or if page_id is now resident
+   */
+  auto AcquireFrameOrWait(std::unique_lock<std::mutex> *latch, frame_id_t *frame_id, std::chrono::milliseconds timeout,
+                          page_id_t page_id) -> bool;
+
+  /** Wake the requests waiting for a frame, if there are any, because a frame may have become available. */
+  void NotifyFrameWaiters();
+
+  /** Outcome of trying to evict the page held in a frame. */
+  enum class EvictResult { EVICTED, PINNED, DIRTY };
+
+  /**
+   * Remove the page held in a frame from the page table, writing it back first if it is dirty. Must be called with
+   * latch_ held.
+   * @param frame_id the frame to evict
+   * @param clean_only if true, leave a dirty page in place instead of writing it back
+   * @return EVICTED if the frame is now unused, PINNED if it is in use (or already free), DIRTY if clean_only was set
+   * and the page is dirty
+   */
+  auto TryEvictFrame(frame_id_t frame_id, bool clean_only) -> EvictResult;
+
+  /**
+   * Write a page back to disk, forcing the log first so that the WAL rule holds. The caller holds the page read latch,
+   * or has made the page unreachable, so that the LSN and the image written are those of one version of the page.
+   * @param page the page to write back
+   */
+  void WritePageToDisk(Page *page);
+
+  /**
+   * Pin a dirty page so that it stays in its frame while it is written back, without taking latch_.
+   * @param page_id id of the page to pin
+   * @return the pinned page, or nullptr if the page is not resident, is being read in or is clean
+   */
+  auto PinForWriteBack(page_id_t page_id) -> Page *;
+
+  /**
+   * Drop the pin taken by PinForWriteBack.
+   * @param page the page that was written back
+   */
+  void UnpinAfterWriteBack(Page *page);
+
+  /** Body of the background writer thread. */
+  void BackgroundWriterLoop(size_t clean_frame_target, std::chrono::milliseconds interval);
+
+  /**
+   * One round of the background writer: sweep the frames and write back unpinned dirty pages until the clean frame
+   * target is met.
+   * @param clean_frame_target number of evictable clean frames to keep ready
+   */
+  void CleanFrames(size_t clean_frame_target);
+
+  /** Wake the background writer early because a miss had to deal with a dirty victim. */
+  void WakeBackgroundWriter();
+
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
    * validate input data and ensure that a parallel BPM is routing requests to the correct BPI
    * @param page_id
+   * @return true if the page id belongs to this BPI and was allocated, see DiskManager::IsAllocatedPage
    */
-  void ValidatePageId(page_id_t page_id) const;
+  auto ValidatePageId(page_id_t page_id) const -> bool;
 
   /** Number of pages in the buffer pool. */
   const size_t pool_size_;
@@ -132,17 +360,73 @@ class BufferPoolManagerInstance : public BufferPoolManager {
 
   /** Array of buffer pool pages. */
   Page *pages_;
+  /** Page data of all frames, PAGE_SIZE bytes per frame, page-aligned. */
+  char *frame_data_ = nullptr;
+  size_t frame_data_size_ = 0;
+  /** NUMA node of the frame memory, -1 if placement was left to the OS. */
+  const int numa_node_;
+  /** Frame memory at least this large is advised to be backed by transparent huge pages. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
+  /** Number of independently latched partitions in the page table. */
+  static constexpr size_t PAGE_TABLE_PARTITIONS = 16;
   /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  PageTablePartition page_table_[PAGE_TABLE_PARTITIONS];
   /** Replacer to find unpinned pages for replacement. */
-  Replacer *replacer_;
+  std::unique_ptr<Replacer> replacer_;
+  /** True for frames whose page is being read from disk, outside of latch_. */
+  std::vector<std::atomic<bool>> loading_;
+  /** True for frames whose read failed verification, until their last pin is dropped. */
+  std::vector<std::atomic<bool>> load_failed_;
+  /** Protects the end of a read against threads about to wait for it in WaitUntilLoaded. */
+  std::mutex load_latch_;
+  /** Signaled whenever a read into a frame has completed. */
+  std::condition_variable load_cv_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** Frames beyond the frame budget. They hold no page and their memory is given back to the OS. */
+  std::list<frame_id_t> reserve_list_;
+  /** Number of frames not in reserve_list_. */
+  std::atomic<size_t> num_frames_;
+  /**
+   * This latch serializes everything that changes which page lives in which frame: the free list, victim selection and
+   * eviction write-back. Reads of missing pages happen after the frame is published, without it. Hits and unpins only
+   * take a page table partition latch.
+   */
   std::mutex latch_;
+
+  /** How many pages FlushDirtyPages pins and writes at a time. */
+  static constexpr size_t FLUSH_BATCH_SIZE = 256;
+  /** How many dirty victims a miss passes over looking for a clean one while the background writer runs. */
+  static constexpr size_t MAX_DIRTY_VICTIM_SKIPS = 16;
+  /** Background writer thread, nullptr when it is not running. */
+  std::thread *background_writer_ = nullptr;
+  /** True while the background writer should keep running. */
+  std::atomic<bool> background_writer_enabled_ = false;
+  /** Set by misses that ran into dirty victims, so the writer starts its next round immediately. */
+  bool background_writer_wakeup_ = false;
+  /** Protects background_writer_wakeup_ and is used with background_writer_cv_. */
+  std::mutex background_writer_latch_;
+  std::condition_variable background_writer_cv_;
+  /** Frame at which the next background writer sweep starts. */
+  size_t background_writer_hand_ = 0;
+  /** Hits, misses, write-backs, latch waits and so on; see BufferPoolCounters. */
+  BufferPoolCounters counters_;
+  /** True while operation latencies are recorded. */
+  std::atomic<bool> track_latency_ = false;
+  /** How long requests wait for a frame when every frame is pinned, 0 not to wait. */
+  std::atomic<std::chrono::milliseconds> frame_wait_timeout_{std::chrono::milliseconds(0)};
+  /**
+   * Number of requests waiting on frame_cv_. Registered with latch_ held before the frames are checked, and read by
+   * unpins after the frame reached the replacer, so an unpin either finds the waiter or the waiter finds the frame.
+   */
+  std::atomic<int> frame_waiters_ = 0;
+  /** Signaled, with latch_, when a frame may have become available to waiting requests. */
+  std::condition_variable frame_cv_;
+  /** Reads pages ahead on behalf of PrefetchPages and PrefetchChain. */
+  std::unique_ptr<Prefetcher> prefetcher_;
 };
 }  // namespace bustub
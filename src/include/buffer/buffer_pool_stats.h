@@ -0,0 +1,188 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+namespace bustub {
+
+/**
+ * LatencyHistogram counts operation latencies in power-of-two buckets: bucket i holds latencies in [2^i, 2^(i+1))
+ * nanoseconds, bucket 0 also holds 0 and the last bucket everything above. Recording is two relaxed atomic adds, so
+ * any number of threads can record into one histogram.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t NUM_BUCKETS = 32;
+
+  /** A copy of the counts at one point in time. */
+  struct Snapshot {
+    std::array<uint64_t, NUM_BUCKETS> buckets_{};
+    /** Number of recorded latencies. */
+    uint64_t count_ = 0;
+    /** Sum of the recorded latencies, in nanoseconds. */
+    uint64_t total_ns_ = 0;
+
+    /**
+     * @param quantile a value between 0 and 1, e.g. 0.99
+     * @return upper bound of the bucket holding the quantile, in nanoseconds, 0 if nothing was recorded
+     */
+    auto Percentile(double quantile) const -> uint64_t;
+
+    /** @return the mean latency in nanoseconds, 0 if nothing was recorded */
+    auto Mean() const -> double { return count_ == 0 ? 0 : static_cast<double>(total_ns_) / count_; }
+
+    /** Add the counts of another histogram, e.g. of another instance. */
+    auto operator+=(const Snapshot &other) -> Snapshot &;
+  };
+
+  /** Measures the lifetime of a scope into a histogram; does nothing for a null histogram. */
+  class ScopedTimer {
+   public:
+    explicit ScopedTimer(LatencyHistogram *histogram) : histogram_(histogram) {
+      if (histogram_ != nullptr) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~ScopedTimer() {
+      if (histogram_ != nullptr) {
+        histogram_->Record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+      }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    auto operator=(const ScopedTimer &) -> ScopedTimer & = delete;
+
+   private:
+    LatencyHistogram *histogram_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /**
+   * Count one latency.
+   * @param ns the latency in nanoseconds
+   */
+  void Record(uint64_t ns);
+
+  /** @return a copy of the current counts */
+  auto GetSnapshot() const -> Snapshot;
+
+ private:
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+  std::atomic<uint64_t> total_ns_ = 0;
+};
+
+/**
+ * Event counters of one buffer pool instance. They are updated with relaxed atomic adds on the paths they count and
+ * never take a latch, so reading them gives a consistent value per counter but not across counters.
+ */
+struct BufferPoolCounters {
+  /** Fetches that found their page in the buffer pool. */
+  std::atomic<uint64_t> hits_ = 0;
+  /** Fetches that read their page from disk. */
+  std::atomic<uint64_t> misses_ = 0;
+  /** Pages created by NewPage. */
+  std::atomic<uint64_t> new_pages_ = 0;
+  /** Pages deleted by DeletePage. */
+  std::atomic<uint64_t> deleted_pages_ = 0;
+  /** Pages evicted to make room for another page. */
+  std::atomic<uint64_t> evictions_ = 0;
+  /** Dirty victims written back by a miss, i.e. while a foreground request waited. */
+  std::atomic<uint64_t> foreground_writes_ = 0;
+  /** Pages written back ahead of eviction by the background writer. */
+  std::atomic<uint64_t> background_writes_ = 0;
+  /** Pages written by FlushPage and FlushAllPages. */
+  std::atomic<uint64_t> flush_writes_ = 0;
+  /** How many times a thread had to wait for the instance latch. */
+  std::atomic<uint64_t> latch_waits_ = 0;
+  /** Total time threads spent waiting for the instance latch, in nanoseconds. */
+  std::atomic<uint64_t> latch_wait_ns_ = 0;
+  /** Fetches and new pages that found every frame pinned and waited for one, see SetFrameWaitTimeout. */
+  std::atomic<uint64_t> frame_waits_ = 0;
+  /** Frame waits that ended without a frame. */
+  std::atomic<uint64_t> frame_wait_timeouts_ = 0;
+  /** Total time spent waiting for a frame, in nanoseconds. */
+  std::atomic<uint64_t> frame_wait_ns_ = 0;
+  /** Latencies of FetchPage, NewPage and FlushPage, only recorded while latency tracking is on. */
+  LatencyHistogram fetch_latency_;
+  LatencyHistogram new_page_latency_;
+  LatencyHistogram flush_latency_;
+};
+
+/**
+ * A snapshot of the counters of one buffer pool instance, or the sum over several, together with the state of the
+ * frames at the time it was taken.
+ */
+struct BufferPoolStats {
+  /** Resident pages are counted by pin count, in the buckets 0, 1, 2, 3-4, 5-8 and 9 or more. */
+  static constexpr size_t PIN_COUNT_BUCKETS = 6;
+
+  /** Frames the buffer pool currently uses. */
+  size_t frames_ = 0;
+  /** Frames holding a page. */
+  size_t resident_pages_ = 0;
+  /** Resident pages that differ from their disk copy. */
+  size_t dirty_pages_ = 0;
+  /** Resident pages by pin count, see PIN_COUNT_BUCKETS. */
+  std::array<uint64_t, PIN_COUNT_BUCKETS> pin_counts_{};
+
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t new_pages_ = 0;
+  uint64_t deleted_pages_ = 0;
+  uint64_t evictions_ = 0;
+  uint64_t foreground_writes_ = 0;
+  uint64_t background_writes_ = 0;
+  uint64_t flush_writes_ = 0;
+  /** Pages read ahead by the prefetcher. */
+  uint64_t prefetches_ = 0;
+  uint64_t latch_waits_ = 0;
+  uint64_t latch_wait_ns_ = 0;
+  uint64_t frame_waits_ = 0;
+  uint64_t frame_wait_timeouts_ = 0;
+  uint64_t frame_wait_ns_ = 0;
+
+  LatencyHistogram::Snapshot fetch_latency_;
+  LatencyHistogram::Snapshot new_page_latency_;
+  LatencyHistogram::Snapshot flush_latency_;
+
+  /**
+   * Copy the counters of an instance. The frame state is left for the caller to fill in.
+   * @param counters the counters to copy
+   */
+  void AddCounters(const BufferPoolCounters &counters);
+
+  /**
+   * Count a resident page.
+   * @param pin_count the pin count of the page
+   * @param is_dirty true if the page is dirty
+   */
+  void AddResidentPage(int pin_count, bool is_dirty);
+
+  /** @return the share of fetches that were hits, 0 if there were none */
+  auto HitRatio() const -> double;
+
+  /** Add the statistics of another instance. */
+  auto operator+=(const BufferPoolStats &other) -> BufferPoolStats &;
+
+  /** @return the statistics on one line, for logging */
+  auto ToString() const -> std::string;
+};
+
+}  // namespace bustub
@@ -12,9 +12,9 @@
 
 #pragma once
 
-#include <list>
+#include <atomic>
+#include <memory>
 #include <mutex>  // NOLINT
-#include <vector>
 
 #include "buffer/replacer.h"
 #include "common/config.h"
@@ -23,6 +23,11 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Every frame has two bits, evictable and referenced, packed 32 frames to an atomic 64-bit word. Pin and Unpin are a
+ * single atomic bit clear / bit set on that word and never block. Only Victim, which moves the clock hand, takes a
+ * latch. The sweep skips whole words without an evictable frame, so it stays cheap on pools with hundreds of thousands
+ * of mostly pinned frames.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -46,7 +51,28 @@ class ClockReplacer : public Replacer {
   auto Size() -> size_t override;
 
  private:
-  // TODO(student): implement me!
+  /** Number of frames whose bits share one word. */
+  static constexpr size_t FRAMES_PER_WORD = 32;
+  /** The evictable bit of every frame in a word; the referenced bit of a frame sits right above it. */
+  static constexpr uint64_t EVICTABLE_BITS = 0x5555555555555555;
+
+  /** @return the index of the word holding frame_id's bits */
+  static auto WordIndex(size_t frame_id) -> size_t { return frame_id / FRAMES_PER_WORD; }
+
+  /** @return the evictable bit of frame_id within its word */
+  static auto EvictableBit(size_t frame_id) -> uint64_t { return uint64_t{1} << (frame_id % FRAMES_PER_WORD * 2); }
+
+  /** Move the clock hand forward by n frames. The caller must hold hand_latch_. */
+  void AdvanceHand(size_t n) { hand_ = (hand_ + n) % num_pages_; }
+
+  const size_t num_pages_;
+  /** Packed evictable and referenced bits of every frame. */
+  std::unique_ptr<std::atomic<uint64_t>[]> bits_;
+  /** Number of evictable frames. */
+  std::atomic<size_t> size_{0};
+  /** The frame the clock hand points at. Protected by hand_latch_. */
+  size_t hand_{0};
+  std::mutex hand_latch_;
 };
 
 }  // namespace bustub
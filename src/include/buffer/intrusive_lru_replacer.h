@@ -0,0 +1,69 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer.h
+//
+// Identification: src/include/buffer/intrusive_lru_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * IntrusiveLRUReplacer implements the same Least Recently Used policy as LRUReplacer without touching the heap after
+ * construction.
+ *
+ * Frame ids are dense in [0, num_pages), so every frame owns a preallocated list node at its own index and the nodes
+ * are linked by index. Pin, Unpin and Victim are O(1) pointer-free list splices with no allocation and no hashing.
+ */
+class IntrusiveLRUReplacer : public Replacer {
+ public:
+  /**
+   * Create a new IntrusiveLRUReplacer.
+   * @param num_pages the maximum number of pages the IntrusiveLRUReplacer will be required to store
+   */
+  explicit IntrusiveLRUReplacer(size_t num_pages);
+
+  /**
+   * Destroys the IntrusiveLRUReplacer.
+   */
+  ~IntrusiveLRUReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override;
+
+ private:
+  struct ListNode {
+    frame_id_t prev_;
+    frame_id_t next_;
+    bool in_list_{false};
+  };
+
+  /** Unlink frame_id from the list. The caller must hold latch_ and frame_id must be in the list. */
+  void Unlink(frame_id_t frame_id);
+
+  /** Index of the sentinel node: its next_ is the least recently unpinned frame, its prev_ the most recent one. */
+  const frame_id_t head_;
+  /** nodes_[i] is the list node of frame i; nodes_[head_] is the sentinel. */
+  std::vector<ListNode> nodes_;
+  size_t size_{0};
+  std::mutex latch_;
+};
+
+}  // namespace bustub
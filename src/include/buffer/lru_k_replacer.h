@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The victim is the evictable frame whose K-th most recent access lies furthest in the past (its backward K-distance
+ * is the largest). Frames with fewer than K recorded accesses have an infinite K-distance and are evicted first, in
+ * order of their earliest access. A page touched once by a sequential scan therefore leaves the pool before a page
+ * that has been re-referenced, no matter how recent the scan was.
+ *
+ * An access is recorded whenever a frame is pinned. Concurrent pins of an already pinned frame never reach the
+ * replacer and count as a single (correlated) reference. Pages that are only read ahead are not referenced: they wait
+ * among the frames with fewer than K accesses, in order of their arrival, until their first real access.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of accesses after which a frame has a finite backward K-distance
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = DEFAULT_K);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void UnpinUnreferenced(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  /** The K used when none is given. */
+  static constexpr size_t DEFAULT_K = 2;
+
+ private:
+  /** Record an access to frame_id at the current logical time. */
+  void RecordAccess(frame_id_t frame_id);
+
+  /** @return the eviction key of frame_id: its earliest access if it has fewer than K, else its K-th latest */
+  auto EvictionKey(frame_id_t frame_id) const -> std::pair<uint64_t, frame_id_t>;
+
+  /** @return true if frame_id has fewer than K recorded accesses */
+  auto HasInfiniteDistance(frame_id_t frame_id) const -> bool { return access_counts_[frame_id] < k_; }
+
+  /** Forget the access history of frame_id. */
+  void ClearHistory(frame_id_t frame_id);
+
+  const size_t k_;
+  /** Logical clock, advanced on every recorded access. */
+  uint64_t current_timestamp_{0};
+  /** The last k_ access timestamps of every frame, as a ring of k_ slots per frame. */
+  std::vector<uint64_t> history_;
+  /** Number of accesses recorded for every frame (may exceed k_). */
+  std::vector<size_t> access_counts_;
+  /** True for frames that are currently evictable. */
+  std::vector<bool> evictable_;
+  /** Evictable frames with fewer than k_ accesses, ordered by earliest access. */
+  std::set<std::pair<uint64_t, frame_id_t>> history_queue_;
+  /** Evictable frames with at least k_ accesses, ordered by K-th most recent access. */
+  std::set<std::pair<uint64_t, frame_id_t>> cache_queue_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
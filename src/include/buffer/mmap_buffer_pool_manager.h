@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager.h
+//
+// Identification: src/include/buffer/mmap_buffer_pool_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * A read-only buffer pool for replicas that only run queries. The database file is mapped read-only and FetchPage
+ * hands out pages whose data points straight into the mapping: there is no copy out of the disk manager, and nothing
+ * is ever evicted or written back, because the kernel page cache does the caching.
+ *
+ * Pages are read-only: writing to page data faults, and NewPage and DeletePage fail. The pool covers the pages the
+ * file had when the buffer pool was created.
+ */
+class MmapBufferPoolManager : public BufferPoolManager {
+ public:
+  /**
+   * Creates a new MmapBufferPoolManager.
+   * @param disk_manager the disk manager of the database file to map
+   */
+  explicit MmapBufferPoolManager(DiskManager *disk_manager);
+
+  /**
+   * Destroys an existing MmapBufferPoolManager. The mapping itself belongs to the disk manager.
+   */
+  ~MmapBufferPoolManager() override;
+
+  /** @return the number of pages in the mapping */
+  auto GetPoolSize() -> size_t override { return num_pages_; }
+
+  /**
+   * Ask the kernel to read the pages in the background.
+   * @param page_ids ids of the pages to read ahead
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids) override;
+
+ protected:
+  /**
+   * Fetch the requested page. The Page object for a page id is created on its first fetch and kept until the buffer
+   * pool is destroyed.
+   * @param page_id id of page to be fetched
+   * @return the requested page, or nullptr if it lies beyond the mapping
+   */
+  auto FetchPgImp(page_id_t page_id) -> Page * override;
+
+  /**
+   * Unpin the target page.
+   * @param page_id id of page to be unpinned
+   * @param is_dirty ignored, the page cannot have been modified
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
+
+  /**
+   * Pages are never dirty, so there is nothing to flush.
+   * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
+   * @return false if the page lies beyond the mapping, true otherwise
+   */
+  auto FlushPgImp(page_id_t page_id) -> bool override;
+
+  /**
+   * The buffer pool is read-only.
+   * @param[out] page_id set to INVALID_PAGE_ID
+   * @return nullptr
+   */
+  auto NewPgImp(page_id_t *page_id) -> Page * override;
+
+  /**
+   * The buffer pool is read-only.
+   * @param page_id id of page to be deleted
+   * @return false
+   */
+  auto DeletePgImp(page_id_t page_id) -> bool override;
+
+  /**
+   * Pages are never dirty, so there is nothing to flush.
+   */
+  void FlushAllPgsImp() override {}
+
+ private:
+  /**
+   * @param page_id id of a page
+   * @return the Page object of the page if it has been fetched before, nullptr otherwise
+   */
+  auto GetPage(page_id_t page_id) -> Page *;
+
+  /** Start of the read-only mapping of the database file. */
+  char *data_;
+  /** Number of pages in the mapping. */
+  size_t num_pages_;
+  /** Page object of every page, indexed by page id. Slots are filled in on first fetch with a compare-and-swap. */
+  std::unique_ptr<std::atomic<Page *>[]> pages_;
+};
+
+}  // namespace bustub
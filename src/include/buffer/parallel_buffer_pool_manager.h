@@ -12,35 +12,141 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/prefetcher.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
 
 namespace bustub {
 
+/**
+ * ParallelBufferPoolManager spreads pages over several BufferPoolManagerInstances by page id.
+ *
+ * If the pool is NUMA-aware, instances are dealt out round-robin over the NUMA nodes of the machine, and each
+ * allocates its frames on its node. NewPage prefers an instance on the node of the calling thread, so that pages
+ * created by a thread stay close to it. Otherwise the placement of the frames is left to the OS.
+
+ *
+ * Page ids are bound to their instance, so a skewed workload can concentrate on a few instances. With frame
+ * rebalancing, which is off unless requested at construction, a background thread periodically moves frames from the
+ * least loaded instance to the most loaded one, up to twice the configured size per instance; the total number of
+ * frames in use stays the same. The load of an instance is measured by its misses, its fetches and the time spent
+ * waiting for its latch.
+ */
 class ParallelBufferPoolManager : public BufferPoolManager {
  public:
+  /** Buffer pool accesses of the instances on one NUMA node. */
+  struct NumaNodeStats {
+    /** Fetches that found their page in the buffer pool. */
+    uint64_t hits_;
+    /** Fetches that read their page from disk. */
+    uint64_t misses_;
+    /** Fetches issued by threads running on another node. */
+    uint64_t remote_fetches_;
+  };
+
   /**
    * Creates a new ParallelBufferPoolManager.
    * @param num_instances the number of individual BufferPoolManagerInstances to store
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every BufferPoolManagerInstance
+   * @param numa_aware if true, instances allocate their frames on a NUMA node each, and new pages go to an instance on
+   * the node of the calling thread when there is one. Off by default, since it costs a node lookup on every fetch
+   * @param frame_rebalancing if true, every instance reserves frames to grow into and frames follow the load
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRU,
+                            bool numa_aware = false, bool frame_rebalancing = false);
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
    */
   ~ParallelBufferPoolManager() override;
 
+  /** Unpin a page through the instance that owns it, without a page table lookup. */
+  auto UnpinFrame(Page *page, bool is_dirty) -> bool override;
+
+  /** Fetch a page for read-ahead through the instance that owns it. */
+  auto FetchPageForReadAhead(page_id_t page_id) -> Page * override;
+
+  /** Drop a read-ahead pin through the instance that owns the page. */
+  void UnpinReadAheadPage(Page *page) override;
+
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /**
+   * Hand every page to the prefetcher of the instance that owns it, so that reads for different instances proceed in
+   * parallel.
+   * @param page_ids ids of the pages to read ahead
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids) override;
+
+  /**
+   * Chains usually span instances, so they are followed by a prefetcher that fetches through this buffer pool.
+   * @param page_id id of the first page of the chain
+   * @param num_pages maximum number of pages to read ahead
+   * @param next_page returns the id of the page following a page in the chain
+   */
+  void PrefetchChain(page_id_t page_id, size_t num_pages, next_page_fn next_page) override;
+
+  /**
+   * Start the background writer of every BufferPoolManagerInstance.
+   * @param clean_frame_target number of evictable clean frames each instance keeps ready
+   * @param interval how long each writer sleeps between rounds
+   */
+  void RunBackgroundWriters(size_t clean_frame_target,
+                            std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+  /** Stop the background writer of every BufferPoolManagerInstance. */
+  void StopBackgroundWriters();
+
+  /** @return a snapshot of the statistics of every instance, indexed by instance */
+  auto GetInstanceStats() const -> std::vector<BufferPoolStats>;
+
+  /** @return a snapshot of the statistics of all instances together */
+  auto GetStats() const -> BufferPoolStats;
+
+  /**
+   * Turn the latency histograms of every instance on or off, see BufferPoolManagerInstance::SetLatencyTracking.
+   * @param enabled true to record latencies
+   */
+  void SetLatencyTracking(bool enabled);
+
+  /**
+   * Set how long fetches and new pages wait for a frame when every frame is pinned, see
+   * BufferPoolManagerInstance::SetFrameWaitTimeout. A new page only waits once no instance has a frame to give.
+   * @param timeout the longest wait, 0 to return nullptr at once
+   */
+  void SetFrameWaitTimeout(std::chrono::milliseconds timeout);
+
+  /**
+   * Pause or resume frame rebalancing between instances. A pool created without frame rebalancing has no frames to
+   * grow into, so resuming it has no effect.
+   * @param enabled true to let frames follow the load
+   */
+  void SetFrameRebalancing(bool enabled) { frame_rebalancing_ = enabled; }
+
+  /**
+   * Move frames from the least loaded instance since the last round to the most loaded one, if the difference is large
+   * enough to be worth it. Run every REBALANCE_INTERVAL by the rebalancing thread while rebalancing is on.
+   */
+  void RebalanceFrames();
+
+  /** @return the access statistics of every NUMA node, indexed by node; all zero unless the pool is NUMA-aware */
+  auto GetNumaNodeStats() const -> std::vector<NumaNodeStats>;
+
  protected:
   /**
    * @param page_id id of page
@@ -85,16 +191,60 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes all the dirty pages of every instance to disk as one group, see BufferPoolManagerInstance::FlushDirtyPages.
    */
   void FlushAllPgsImp() override;
 
 private:
+  /** Load signals of an instance, as running totals or as the difference between two rounds. */
+  struct InstanceLoad {
+    uint64_t misses_;
+    /** Hits and misses. */
+    uint64_t fetches_;
+    uint64_t latch_wait_ns_;
+  };
+
+  /** Body of the rebalancing thread. */
+  void RebalanceLoop();
+
   size_t num_instance;
   size_t pool_size_;
   size_t starting_index;
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  std::vector<BufferPoolManager*> buffer_pool_managers;
+  std::vector<BufferPoolManagerInstance*> buffer_pool_managers;
+  /** Each instance can grow to this many times its configured size by taking frames from others. */
+  static constexpr size_t MAX_FRAME_GROWTH = 2;
+  /** Instances keep at least 1/MIN_FRAME_SHARE of their configured size. */
+  static constexpr size_t MIN_FRAME_SHARE = 4;
+  /** Frames move in steps of 1/FRAME_STEP_SHARE of the configured instance size. */
+  static constexpr size_t FRAME_STEP_SHARE = 8;
+  /** Time between two rebalancing rounds. */
+  static constexpr std::chrono::milliseconds REBALANCE_INTERVAL{10};
+  /** How long NewPage waits for a frame once every instance is full. */
+  std::atomic<std::chrono::milliseconds> frame_wait_timeout_{std::chrono::milliseconds(0)};
+  /** Frames every instance allocated: its configured size, times MAX_FRAME_GROWTH with frame rebalancing. */
+  size_t max_instance_frames_;
+  /** True while frames follow the load. */
+  std::atomic<bool> frame_rebalancing_;
+  /** Held by the thread running a rebalancing round; others skip the round. */
+  std::mutex rebalance_latch_;
+  /** Load of every instance at the last rebalancing round. */
+  std::vector<InstanceLoad> last_loads_;
+  /** Runs the rebalancing rounds, nullptr if the pool was created without frame rebalancing. */
+  std::thread *rebalance_thread_ = nullptr;
+  /** Set to stop the rebalancing thread. */
+  bool rebalance_thread_stopped_ = false;
+  /** Protects rebalance_thread_stopped_ and is used with rebalance_thread_cv_. */
+  std::mutex rebalance_thread_latch_;
+  std::condition_variable rebalance_thread_cv_;
+  /** If true, instances are bound to NUMA nodes and NewPage prefers those on the node of the calling thread. */
+  bool numa_aware_;
+  /** Number of NUMA nodes the instances are spread over. */
+  int num_numa_nodes_;
+  /** Fetches from threads on another node, per node of the instance fetched from. */
+  std::unique_ptr<std::atomic<uint64_t>[]> remote_fetches_;
+  /** Follows page chains across instances. */
+  std::unique_ptr<Prefetcher> chain_prefetcher_;
 };
 }  // namespace bustub
@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// prefetcher.h
+//
+// Identification: src/include/buffer/prefetcher.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace bustub {
+
+/**
+ * Prefetcher reads pages into a buffer pool on a background thread.
+ *
+ * Requests are queued and served in order by fetching each page through the buffer pool and unpinning it right away.
+ * The fetches go through FetchPageForReadAhead, so the replacer does not count them as accesses: a page that is read
+ * ahead and then scanned has been referenced once. The thread is started on the first request. Prefetching is a hint:
+ * requests are dropped when the queue is full, and a chain stops early when the buffer pool has no frame to spare.
+ */
+class Prefetcher {
+ public:
+  /**
+   * Create a new Prefetcher.
+   * @param buffer_pool_manager the buffer pool to read pages into
+   * @param max_queued_requests requests beyond this many outstanding ones are dropped
+   */
+  Prefetcher(BufferPoolManager *buffer_pool_manager, size_t max_queued_requests);
+
+  /**
+   * Stops and joins the prefetch thread. Queued requests are dropped.
+   */
+  ~Prefetcher();
+
+  /**
+   * Queue single-page requests for page_ids.
+   * @param page_ids ids of the pages to read ahead
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids);
+
+  /**
+   * Queue a request that follows a chain of pages.
+   * @param page_id id of the first page of the chain
+   * @param num_pages maximum number of pages to read ahead
+   * @param next_page returns the id of the page following a page in the chain
+   */
+  void PrefetchChain(page_id_t page_id, size_t num_pages, BufferPoolManager::next_page_fn next_page);
+
+  /** @return the number of pages the prefetcher has fetched, whether or not they were already resident */
+  auto GetPrefetchCount() const -> uint64_t { return prefetch_count_; }
+
+ private:
+  struct PrefetchRequest {
+    page_id_t page_id_{INVALID_PAGE_ID};
+    size_t num_pages_{0};
+    BufferPoolManager::next_page_fn next_page_;
+  };
+
+  /** Queue a request and start the thread if it is not running yet. */
+  void Enqueue(PrefetchRequest request);
+
+  /** Body of the prefetch thread. */
+  void PrefetchLoop();
+
+  /** Fetch the pages of one request. */
+  void Prefetch(const PrefetchRequest &request);
+
+  BufferPoolManager *buffer_pool_manager_;
+  const size_t max_queued_requests_;
+  /** Prefetch thread, nullptr until the first request. */
+  std::thread *prefetch_thread_ = nullptr;
+  /** False once the prefetcher is shutting down. */
+  std::atomic<bool> enabled_ = true;
+  std::deque<PrefetchRequest> queue_;
+  /** Protects queue_ and prefetch_thread_, and is used with queue_cv_. */
+  std::mutex latch_;
+  std::condition_variable queue_cv_;
+  std::atomic<uint64_t> prefetch_count_ = 0;
+};
+
+}  // namespace bustub
@@ -43,8 +43,22 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Unpins a frame whose page was loaded or pinned without being referenced, e.g. by read-ahead. Policies that keep an
+   * access history make the frame evictable without recording an access.
+   * @param frame_id the id of the frame to unpin
+   */
+  virtual void UnpinUnreferenced(frame_id_t frame_id) { Unpin(frame_id); }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
+
+  /**
+   * Forget a frame entirely, including any access history kept for it. Called when the page in the frame is deleted
+   * or evicted, so that the next page loaded into the frame does not inherit its history.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
 };
 
 }  // namespace bustub
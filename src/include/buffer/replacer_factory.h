@@ -0,0 +1,38 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// replacer_factory.h
+//
+// Identification: src/include/buffer/replacer_factory.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+
+#include "buffer/replacer.h"
+
+namespace bustub {
+
+/** The replacement policies a BufferPoolManagerInstance can be built with. */
+enum class ReplacerType { LRU, LRU_K, CLOCK };
+
+/**
+ * ReplacerFactory creates replacers for a given replacement policy.
+ */
+class ReplacerFactory {
+ public:
+  /**
+   * Creates a new replacer.
+   * @param type the replacement policy
+   * @param num_pages the maximum number of pages the replacer will be required to store
+   * @return a replacer implementing the requested policy
+   */
+  static auto CreateReplacer(ReplacerType type, size_t num_pages) -> std::unique_ptr<Replacer>;
+};
+
+}  // namespace bustub
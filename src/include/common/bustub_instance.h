@@ -18,6 +18,7 @@
 #include "concurrency/lock_manager.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -34,6 +35,10 @@ class BustubInstance {
     log_manager_ = new LogManager(disk_manager_);
 
     buffer_pool_manager_ = new ParallelBufferPoolManager(5, BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    // pages that fail checksum verification are rebuilt from the log
+    disk_manager_->SetPageRepairHandler([this](page_id_t page_id, char *page_data) {
+      return LogRecovery(disk_manager_, buffer_pool_manager_).RedoPage(page_id, page_data);
+    });
     // txn related
     lock_manager_ = new LockManager();
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// config.h
+//
+// Identification: src/include/common/config.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+
+// The page size is chosen at build time, e.g. cmake -DBUSTUB_PAGE_SIZE=16384 ..; every page layout derives its
+// capacity from PAGE_SIZE.
+#ifndef BUSTUB_PAGE_SIZE
+#define BUSTUB_PAGE_SIZE 4096
+#endif
+
+// Whether hash table bucket pages keep a fingerprint byte per slot, e.g. cmake -DBUSTUB_HASH_FINGERPRINTS=OFF ..
+#ifndef BUSTUB_HASH_FINGERPRINTS
+#define BUSTUB_HASH_FINGERPRINTS 1
+#endif
+
+namespace bustub {
+
+/** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
+extern std::chrono::milliseconds cycle_detection_interval;
+
+/** True if logging should be enabled, false otherwise. */
+extern std::atomic<bool> enable_logging;
+
+/** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
+extern std::chrono::duration<int64_t> log_timeout;
+
+static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
+static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
+static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
+static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
+static constexpr int PAGE_SIZE = BUSTUB_PAGE_SIZE;                            // size of a data page in byte
+static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
+static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+
+// Direct I/O transfers whole pages from page-aligned buffers, so a page spans a whole number of 4 KiB blocks.
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 65536 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+              "PAGE_SIZE must be a power of two between 4 KiB and 64 KiB");
+
+using frame_id_t = int32_t;    // frame id type
+using page_id_t = int32_t;     // page id type
+using txn_id_t = int32_t;      // transaction id type
+using lsn_t = int32_t;         // log sequence number type
+using slot_offset_t = size_t;  // slot offset type
+using oid_t = uint16_t;
+
+}  // namespace bustub
@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// numa.h
+//
+// Identification: src/include/common/numa.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * NumaUtil tells which NUMA node the calling thread runs on and places memory on a chosen node. It talks to the kernel
+ * directly, so it needs no libnuma.
+ *
+ * On single-node machines EmulateNodes pretends there are several nodes, so that node-aware code can be tested and
+ * measured anywhere. Emulated nodes share the same memory, so binding memory to one of them does nothing.
+ */
+class NumaUtil {
+ public:
+  /** @return the number of NUMA nodes, at least 1 */
+  static auto GetNumNodes() -> int;
+
+  /** @return the node of the CPU the calling thread is running on */
+  static auto GetCurrentNode() -> int;
+
+  /**
+   * Ask the kernel to place a memory range on a node. Only pages touched after the call are affected.
+   * @param addr start of the range, aligned to the OS page size
+   * @param size length of the range in bytes
+   * @param node the node to place the memory on
+   * @return false if the kernel refused, true otherwise
+   */
+  static auto BindToNode(void *addr, size_t size, int node) -> bool;
+
+  /**
+   * Pretend the machine has num_nodes nodes.
+   * @param num_nodes number of nodes to emulate, 0 to go back to the real topology
+   */
+  static void EmulateNodes(int num_nodes);
+
+  /**
+   * Set the emulated node of the calling thread. Threads that never call this are spread over the emulated nodes by
+   * CPU id.
+   * @param node the node the calling thread pretends to run on
+   */
+  static void SetCurrentNode(int node);
+};
+
+}  // namespace bustub
@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.h
+//
+// Identification: src/include/common/util/crc32c.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * CRC32C (Castagnoli), the checksum of iSCSI, ext4 and most storage engines. On x86 CPUs with SSE4.2 it is computed
+ * with the crc32 instruction, on three independent streams at once so that the latency of one instruction is hidden
+ * behind the other two; elsewhere with a lookup table.
+ */
+class Crc32c {
+ public:
+  /**
+   * Compute the CRC32C of a buffer, or extend the CRC of the bytes before it.
+   * @param crc CRC32C of the preceding bytes, 0 for the start of a buffer
+   * @param data the bytes to checksum
+   * @param length number of bytes
+   * @return the CRC32C of the preceding bytes followed by data
+   */
+  static auto Extend(uint32_t crc, const char *data, size_t length) -> uint32_t;
+
+  /** @return the CRC32C of a buffer */
+  static auto Value(const char *data, size_t length) -> uint32_t { return Extend(0, data, length); }
+
+  /** @return true if the CRC is computed by the CPU */
+  static auto IsHardwareAccelerated() -> bool;
+};
+
+}  // namespace bustub
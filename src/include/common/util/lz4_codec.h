@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.h
+//
+// Identification: src/include/common/util/lz4_codec.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+namespace bustub {
+
+/**
+ * A compact implementation of the LZ4 block format, https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md.
+ * Blocks compressed here can be decompressed by the LZ4 library and vice versa, but the names differ from those of
+ * the library, so that a process linking both gets each. The compressor is a greedy single-probe hash matcher, like
+ * the fast mode of the library without acceleration.
+ */
+class Lz4Codec {
+ public:
+  /** @return the maximum size of the compressed form of input_size bytes, the worst case for incompressible data */
+  static auto CompressBound(int input_size) -> int;
+
+  /**
+   * Compress src_size bytes from src into dst.
+   * @return the number of bytes written to dst, or 0 if the compressed form does not fit into dst_capacity bytes
+   */
+  static auto Compress(const char *src, char *dst, int src_size, int dst_capacity) -> int;
+
+  /**
+   * Decompress a block of compressed_size bytes from src into dst. Malformed input never makes it read or write out
+   * of bounds.
+   * @return the number of bytes written to dst, or a negative value if the block is malformed or does not fit into
+   * dst_capacity bytes
+   */
+  static auto Decompress(const char *src, char *dst, int compressed_size, int dst_capacity) -> int;
+};
+
+}  // namespace bustub
@@ -12,6 +12,10 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
 #include <vector>
@@ -21,6 +25,7 @@
 #include "container/hash/hash_function.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
+#include "storage/page/extendible_hash_table_header_page.h"
 
 namespace bustub {
 
@@ -30,6 +35,26 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * A lookup takes three steps of constant length: the header page maps the top bits of the hash to a directory page,
+ * the directory maps the low bits to a bucket page, and the bucket holds the key. Every directory holds at most
+ * DIRECTORY_ARRAY_SIZE buckets with its own global depth, so the header depth multiplies the capacity of the table.
+ * Directories are created when the first key of their header slot is inserted, and are never removed.
+ *
+ * There is no latch on the whole table. The header page latch protects the header, each directory page latch its
+ * directory and the bucket page latches the buckets. A bucket is pinned while its directory is latched, but latched
+ * only after the directory latch is released, and then validated against the directory: it is the bucket of a key as
+ * long as its latch is held, because the directory entries of a bucket only change while the bucket is write latched.
+ * A version counter per directory, bumped by every split and merge, lets the validation skip the directory if it has
+ * not changed. Splits and merges latch the buckets they change and then the directory, never the other way round,
+ * and hold the directory latch only for the update of its entries. Operations on other buckets keep running
+ * meanwhile. Only the creation of a directory write latches the header.
+ *
+ * The header page stays pinned for as long as the table lives, so lookups latch it without going through the
+ * buffer pool; directory pages are fetched like any other page. With optimistic reads on, lookups read neither:
+ * splits and merges copy their directory into an in-memory mirror, and lookups read the mirror like a seqlock,
+ * between two reads of the directory version, which is odd while the mirror is being updated. The bucket is
+ * validated as before once it is latched.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +65,23 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param header_depth the number of top hash bits that select a directory, at most HEADER_MAX_DEPTH
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               uint32_t header_depth = DEFAULT_HEADER_DEPTH);
+
+  /**
+   * Releases the pin on the header page, and deletes the bucket pages still waiting to be deleted. The buffer pool
+   * must outlive the table.
+   */
+  ~ExtendibleHashTable();
+
+  /**
+   * The header depth of tables that do not ask for one: 8 directories, which keeps a small table at a few pages and
+   * still holds millions of keys. Tables that expect more keys ask for a deeper header.
+   */
+  static constexpr uint32_t DEFAULT_HEADER_DEPTH = 3;
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -75,12 +114,32 @@ class ExtendibleHashTable {
   auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
 
   /**
-   * Returns the global depth.  Do not touch.
+   * Performs a batch of point queries. The keys are hashed up front and mapped to their buckets before any bucket is
+   * read; keys of the same bucket are then looked up under one latch of the bucket page, and the next bucket
+   * is pinned and prefetched while the current one is probed.
+   *
+   * @param transaction the current transaction
+   * @param keys the keys to look up
+   * @param[out] results the value(s) associated with each key, in the order of keys
+   * @return the number of keys that have at least one value
+   */
+  auto GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                 std::vector<std::vector<ValueType>> *results) -> size_t;
+
+  /**
+   * Turn optimistic reads of the in-memory directory mirrors on or off. They are on by default; with them off, every
+   * operation read latches the header page and its directory page.
+   * @param enabled true to read the mirror
+   */
+  void SetOptimisticReads(bool enabled) { optimistic_reads_ = enabled; }
+
+  /**
+   * Returns the largest global depth of the directories.  Do not touch.
    */
   auto GetGlobalDepth() -> uint32_t;
 
   /**
-   * Helper function to verify the integrity of the extendible hash table's directory.  Do not touch.
+   * Helper function to verify the integrity of the extendible hash table's directories.  Do not touch.
    */
   void VerifyIntegrity();
 
@@ -110,7 +169,7 @@ class ExtendibleHashTable {
    * @param dir_page to use for lookup of global depth
    * @return the directory index
    */
-  inline auto KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  inline auto KeyToDirectoryIndex(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
    * Get the bucket page_id corresponding to a key.
@@ -119,32 +178,92 @@ class ExtendibleHashTable {
    * @param dir_page a pointer to the hash table's directory page
    * @return the bucket page_id corresponding to the input key
    */
-  inline auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  inline auto KeyToPageId(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t;
+
+  /** The in-memory mirror of a directory, see the class comment. */
+  struct DirectoryMirror {
+    // the directory page, INVALID_PAGE_ID until the directory is created; it does not change afterwards
+    std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
+    // incremented twice by every split and merge while it changes the directory, so odd while the mirror is updated
+    std::atomic<uint64_t> version_ = 0;
+    // the global depth mask and bucket page ids of the directory, as of the last even version
+    std::atomic<uint32_t> global_depth_mask_ = 0;
+    std::array<std::atomic<page_id_t>, DIRECTORY_ARRAY_SIZE> bucket_page_ids_{};
+  };
+
+  /**
+   * @param hash the hash of a key
+   * @return the mirror of the directory of the hash
+   */
+  inline auto MirrorOf(uint32_t hash) -> DirectoryMirror &;
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Looks up the bucket of a hash in the mirror of its directory.
    *
-   * @return a pointer to the directory page
+   * @param hash the hash of the key for lookup
+   * @param[out] bucket_page_id the bucket page id, INVALID_PAGE_ID if the directory does not exist yet
+   * @param[out] directory_version the directory version the bucket was looked up in
+   * @return false if a split or merge was updating the mirror
    */
-  auto FetchDirectoryPage() -> HashTableDirectoryPage *;
+  auto ReadMirror(uint32_t hash, page_id_t *bucket_page_id, uint64_t *directory_version) -> bool;
 
   /**
-   * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
+   * Looks up the bucket of a hash in the header and directory pages, and pins it while the directory is read latched.
    *
-   * @param bucket_page_id the page_id to fetch
-   * @return a pointer to a bucket page
+   * @param hash the hash of the key for lookup
+   * @param[out] directory_version the directory version the bucket was looked up in
+   * @param[out] bucket_pin if not null, receives the pin of the bucket
+   * @return the bucket page id, INVALID_PAGE_ID if the directory does not exist yet or has no frame
    */
-  auto FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
+  auto ReadDirectory(uint32_t hash, uint64_t *directory_version, BasicPageGuard *bucket_pin) -> page_id_t;
 
   /**
-   * Performs insertion with an optional bucket splitting.
+   * Pins the bucket page of a hash. The bucket is not latched, and has to be validated with IsBucketOf once it is.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key to insert
-   * @param value the value to insert
-   * @return whether or not the insertion was successful
+   * @param hash the hash of the key for lookup
+   * @param[out] directory_version the directory version the bucket was looked up in
+   * @return a guard holding the pin, empty if the directory does not exist yet or the buffer pool has no frame
+   */
+  auto PinBucketPage(uint32_t hash, uint64_t *directory_version) -> BasicPageGuard;
+
+  /**
+   * Pins a bucket page looked up in the mirror, and keeps the pin only if the directory version has not changed
+   * since: the page is then still a bucket page, if not necessarily the bucket of the hash any more.
+   *
+   * @param hash the hash of the key for lookup
+   * @param bucket_page_id the bucket page id read from the mirror
+   * @param directory_version the directory version the bucket was looked up in
+   * @return a guard holding the pin, empty if the version changed or the buffer pool has no frame
+   */
+  auto PinMirroredBucket(uint32_t hash, page_id_t bucket_page_id, uint64_t directory_version) -> BasicPageGuard;
+
+  /**
+   * Checks whether a bucket is still the bucket of a hash, after it was latched. If no split or merge has changed the
+   * directory since the lookup, it is, and the directory is not read again.
+   *
+   * @param hash the hash of the key for lookup
+   * @param bucket_page_id the page id of the latched bucket
+   * @param directory_version the directory version returned by PinBucketPage
+   * @return true if the directory maps the hash to the bucket
+   */
+  auto IsBucketOf(uint32_t hash, page_id_t bucket_page_id, uint64_t directory_version) -> bool;
+
+  /**
+   * Creates the directory of a hash, with a single empty bucket, unless it exists already.
+   *
+   * @param hash the hash of the key being inserted
+   * @return false if there is no frame for the new pages
+   */
+  auto CreateDirectory(uint32_t hash) -> bool;
+
+  /**
+   * Splits a full bucket: publishes a new bucket in the directory and moves the keys of its split image over.
+   *
+   * @param[in,out] bucket_guard the write latched bucket to split
+   * @param key the key being inserted, which stays in the bucket
+   * @return false if the directory is full or there is no frame for the new bucket
    */
-  auto SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool;
+  auto SplitBucket(WritePageGuard *bucket_guard, const KeyType &key) -> bool;
 
   /**
    * Optionally merges an empty bucket into it's pair.  This is called by Remove,
@@ -155,20 +274,38 @@ class ExtendibleHashTable {
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
    *
+   * The emptied bucket page is deleted once nobody has it pinned; until then it is retired, and a later merge deletes
+   * it.
+   *
    * @param transaction a pointer to the current transaction
    * @param key the key that was removed
    * @param value the value that was removed
    */
   void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
 
+  /**
+   * Copies a directory into its mirror, between two increments of the directory version. Called by splits and
+   * merges while they hold the directory write latch.
+   *
+   * @param[out] mirror the mirror of the directory
+   * @param dir_page the updated directory
+   */
+  void PublishDirectory(DirectoryMirror *mirror, const HashTableDirectoryPage *dir_page);
+
   // member variables
-  page_id_t directory_page_id_;
+  page_id_t header_page_id_;
+  // the header page, pinned from construction to destruction
+  Page *header_page_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writers are splits and merges
-  ReaderWriterLatch table_latch_;
   HashFunction<KeyType> hash_fn_;
+  std::atomic<bool> optimistic_reads_ = true;
+  // one mirror per header slot
+  std::unique_ptr<DirectoryMirror[]> directory_mirrors_;
+  // bucket pages merged away while another thread still had them pinned, deleted by a later merge
+  std::vector<page_id_t> retired_pages_;
+  std::mutex retired_latch_;
 };
 
 }  // namespace bustub
@@ -28,7 +28,8 @@
 namespace bustub {
 
 /**
- * IndexJoinExecutor executes index join operations.
+ * IndexJoinExecutor executes index join operations. The outer tuples are read in batches of BATCH_SIZE, and the index
+ * keys of a batch are looked up with a single Index::ScanKeys call.
  */
 class NestIndexJoinExecutor : public AbstractExecutor {
  public:
@@ -47,8 +48,33 @@ class NestIndexJoinExecutor : public AbstractExecutor {
 
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
+  /** Number of outer tuples whose index lookups are batched together. */
+  static constexpr size_t BATCH_SIZE = 128;
+
  private:
+  /**
+   * Reads the next batch of outer tuples and looks up their keys in the index.
+   * @return false if the outer table is exhausted
+   */
+  auto NextBatch() -> bool;
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
+  /** Child executor producing the outer tuples */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The inner table */
+  TableInfo *inner_table_info_;
+  /** The index on the inner table */
+  IndexInfo *index_info_;
+  /** The side of the predicate that is evaluated on the outer tuple to get the index key */
+  const AbstractExpression *outer_key_expr_;
+  /** The current batch of outer tuples */
+  std::vector<Tuple> outer_tuples_;
+  /** RIDs of the inner tuples matching each outer tuple of the batch */
+  std::vector<std::vector<RID>> inner_rids_;
+  /** The outer tuple being joined */
+  size_t outer_idx_{0};
+  /** The next of its inner RIDs */
+  size_t rid_idx_{0};
 };
 }  // namespace bustub
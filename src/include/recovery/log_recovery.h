@@ -41,7 +41,20 @@ class LogRecovery {
   void Undo();
   auto DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool;
 
+  /**
+   * Rebuild a table page from the log, e.g. after it failed checksum verification. Does not go through the buffer
+   * pool, so it can serve as the page repair handler of the disk manager. Works with logging off, as during recovery;
+   * Redo fetches every page the log touches, so a torn page the log can rebuild is met there.
+   * @param page_id id of the page
+   * @param[out] page_data PAGE_SIZE bytes that receive the page
+   * @return true if the log holds the creation of the page, i.e. the page was rebuilt
+   */
+  auto RedoPage(page_id_t page_id, char *page_data) -> bool;
+
  private:
+  /** Deserialize a log record that must end before buffer_end. */
+  auto DeserializeLogRecord(const char *data, const char *buffer_end, LogRecord *log_record) -> bool;
+
   DiskManager *disk_manager_ __attribute__((__unused__));
   BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
 
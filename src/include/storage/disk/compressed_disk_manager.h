@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.h
+//
+// Identification: src/include/storage/disk/compressed_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * CompressedDiskManager stores every page LZ4-compressed, so that mostly empty or repetitive pages take a fraction of
+ * a page on disk and scans read fewer bytes. It plugs in wherever a DiskManager is expected; the buffer pool still
+ * sees PAGE_SIZE pages.
+ *
+ * A compressed page is stored as a record in an extent, a run of SECTOR_SIZE sectors. The record header names the
+ * page and carries a sequence number, so the extent map (page id -> extent) is rebuilt by scanning the file when it is
+ * opened: for every page, the record with the highest sequence number wins. A rewritten page goes to a new extent and
+ * the old one is reused for a later record of the same size class. Pages that do not compress are stored as is.
+ * The record header also carries the checksum of the page image, which is verified after decompression.
+ *
+ * The file format differs from that of DiskManager, so a file written by one cannot be read by the other.
+ */
+class CompressedDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new compressed disk manager that writes to the specified database file, and reads its extent map.
+   * @param db_file the file name of the database file to write to
+   */
+  explicit CompressedDiskManager(const std::string &db_file);
+
+  /**
+   * Compress a page and write it to a free extent of the database file.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Read a page from the database file, decompress it and verify its checksum. Pages that were never written read as
+   * zeros.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
+
+  /**
+   * Perform a batch of page reads and writes, one page at a time.
+   * @param requests the reads and writes to perform
+   */
+  void SubmitRequests(std::vector<DiskRequest> *requests) override;
+
+  /**
+   * Record that a page is no longer used and make its extent free.
+   * @param page_id id of the deleted page
+   * @return false if the page id was never allocated
+   */
+  auto DeallocatePage(page_id_t page_id) -> bool override;
+
+  /**
+   * Punch a hole for every free extent. The file is not truncated, since free extents are kept by offset.
+   * @return the number of bytes given back to the file system
+   */
+  auto CompactFile() -> uint64_t override;
+
+  /**
+   * Pages are not stored in place, so the file cannot be used through a mapping.
+   * @param[out] num_pages set to 0
+   * @return nullptr
+   */
+  auto MapReadOnly(size_t *num_pages) -> const char * override;
+
+  /** @return the number of bytes taken by the current version of every page, i.e. the file size without free space */
+  auto GetStoredBytes() -> uint64_t;
+
+  /** Extents are made of sectors of this many bytes. */
+  static constexpr size_t SECTOR_SIZE = 512;
+
+ private:
+  /** Header in front of every compressed page. */
+  struct RecordHeader {
+    uint32_t magic_;
+    page_id_t page_id_;
+    /** Size of the data following the header; PAGE_SIZE means the page is stored uncompressed. */
+    uint32_t data_size_;
+    /** Size of the extent holding the record, in sectors. */
+    uint32_t num_sectors_;
+    /** Orders the records of one page: the highest one is the current version. */
+    uint64_t sequence_;
+    /** Checksum of the uncompressed page, 0 if it was written with checksums off. */
+    uint32_t checksum_;
+  };
+
+  /** Where the current version of a page is stored. */
+  struct Extent {
+    uint64_t offset_;
+    uint32_t num_sectors_;
+    uint64_t sequence_;
+  };
+
+  static constexpr uint32_t RECORD_MAGIC = 0x5A4C5442;
+  /** Largest extent: a header and an uncompressed page. */
+  static constexpr size_t MAX_RECORD_SIZE =
+      (sizeof(RecordHeader) + PAGE_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+
+  /** Scan the database file and build the extent map and the free extent lists. */
+  void LoadExtentMap();
+
+  /**
+   * Take a free extent of the given size, or append one at the end of the file. Must be called with latch_ held.
+   * @param num_sectors size of the extent
+   * @return offset of the extent in the file
+   */
+  auto AllocateExtent(uint32_t num_sectors) -> uint64_t;
+
+  /** Protects extents_, free_extents_, end_offset_ and next_sequence_. The I/O itself happens without it. */
+  std::mutex latch_;
+  /** Current extent of every page written so far. */
+  std::unordered_map<page_id_t, Extent> extents_;
+  /** Offsets of unused extents, by size in sectors. */
+  std::unordered_map<uint32_t, std::vector<uint64_t>> free_extents_;
+  /** End of the last extent in the file. */
+  uint64_t end_offset_ = 0;
+  /** Sequence number of the next record written. */
+  uint64_t next_sequence_ = 1;
+};
+
+}  // namespace bustub
@@ -12,11 +12,17 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <fstream>
+#include <functional>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
 
@@ -25,16 +31,71 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Pages are read and written with positional I/O (pread/pwrite) on a raw file descriptor. There is no file cursor to
+ * share and no lock around page I/O, so reads and writes issued by different threads are in flight at the same time.
+ *
+ * If the database file cannot be opened for writing (e.g. on a read-only replica), it is opened read-only; reads and
+ * MapReadOnly work, writes fail.
+ *
+ * In direct I/O mode the database file is opened with O_DIRECT and page I/O bypasses the kernel page cache, so pages
+ * are cached once, in the buffer pool, instead of twice. Buffer pool frames are suitably aligned; other buffers are
+ * copied through an aligned bounce buffer.
+ *
+ * Deleted pages are recorded in a free page map, a bitmap with one bit per page that is kept next to the database
+ * file (foo.db -> foo.fsm). AllocateFreePage hands them out again, lowest page id first, so the file stops growing
+ * once inserts and deletes balance out. CompactFile gives the space of free pages back to the file system.
+ *
+ * Every page written is checksummed with CRC32C and the checksum is verified when the page is read back, so that a
+ * page torn by a crash in the middle of its write, or damaged on disk, is not handed to the buffer pool as if it were
+ * valid. The checksums are kept next to the database file (foo.db -> foo.crc), four bytes per page, and not in the
+ * page itself, whose every byte belongs to the page layouts. A page that fails verification is handed to the page
+ * repair handler, e.g. WAL redo, and written back if it was repaired; otherwise the read fails, the page reads as
+ * zeros and is reported by GetCorruptPages.
+ *
+ * The checksum file only holds checksums that are durable together with their page, and 0 (no checksum) otherwise.
+ * Before a page with a checksum in the file is overwritten, its entry is cleared and the file synced; the new
+ * checksum is written once the db file has been synced, on ShutDown. A crash therefore never leaves a valid page
+ * behind a checksum it does not match. Within a run, pages are verified against the checksum of their last write,
+ * which is kept in memory. The flip side is that a page torn by a crash is only detected if it was not written since
+ * the last ShutDown; for the others, it takes the double-write buffer.
+ *
+ * With the double-write buffer on, page writes cannot be torn either. Every write, of a single page or of a
+ * SubmitRequests batch, is first written in one sequential write to a file of its own (foo.db -> foo.dwb) and synced,
+ * and only then written in place. On startup, pages that were torn in place are restored from their copy in the
+ * double-write buffer.
  */
 class DiskManager {
  public:
+  /** A page read or write handed to SubmitRequests. */
+  struct DiskRequest {
+    /** True for a write of data_ to the page, false for a read of the page into data_. */
+    bool is_write_;
+    page_id_t page_id_;
+    /** PAGE_SIZE bytes to write from or read into. */
+    char *data_;
+  };
+
+  /**
+   * Rebuilds the image of a page that failed checksum verification.
+   * @param page_id id of the page
+   * @param[in,out] page_data PAGE_SIZE bytes, zeros on the call; the rebuilt page on return
+   * @return true if the page was rebuilt
+   */
+  using page_repair_fn = std::function<bool(page_id_t page_id, char *page_data)>;
+
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param direct_io true to bypass the kernel page cache for page I/O. Falls back to buffered I/O if the file
+   * system does not support it.
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool direct_io = false);
 
-  ~DiskManager() = default;
+  /**
+   * Closes the database file if ShutDown was not called.
+   */
+  virtual ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -42,18 +103,72 @@ class DiskManager {
   void ShutDown();
 
   /**
-   * Write a page to the database file.
+   * Write a page to the database file, through the double-write buffer if it is on.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
+   * @return false if the page failed verification and could not be repaired; it then reads as zeros
+   */
+  virtual auto ReadPage(page_id_t page_id, char *page_data) -> bool;
+
+  /**
+   * Perform a batch of page reads and writes and return once all of them have completed. Requests are sorted by page
+   * id, and requests of the same kind for consecutive pages are coalesced into one vectored system call, so a batch
+   * of N adjacent pages costs one I/O instead of N. The requests of a batch must not touch the same page twice.
+   * @param requests the reads and writes to perform; reordered by page id on return
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void SubmitRequests(std::vector<DiskRequest> *requests);
+
+  /**
+   * Record that a page is no longer used, so that AllocateFreePage can hand it out again.
+   * @param page_id id of the deleted page
+   * @return false if the page id was never allocated, see IsAllocatedPage; nothing is recorded then
+   */
+  virtual auto DeallocatePage(page_id_t page_id) -> bool;
+
+  /**
+   * Record that a buffer pool handed out a new page id, so that the page can be deallocated even before it is written.
+   * @param page_id id of the new page
+   */
+  void RecordAllocatedPage(page_id_t page_id);
+
+  /**
+   * @return true if the page id is not negative and below the highest id handed out by a buffer pool, written, or
+   * found in the files at startup. Deallocating any other id would put a page that does not exist in the free map.
+   */
+  auto IsAllocatedPage(page_id_t page_id) const -> bool { return page_id >= 0 && page_id < page_high_water_; }
+
+  /**
+   * Take the lowest free page whose id belongs to a buffer pool instance, i.e. page_id % num_instances ==
+   * instance_index.
+   * @param num_instances number of buffer pool instances sharing the file
+   * @param instance_index index of the allocating instance
+   * @return the page id, or INVALID_PAGE_ID if the instance has no free page
+   */
+  auto AllocateFreePage(uint32_t num_instances, uint32_t instance_index) -> page_id_t;
+
+  /**
+   * @return true if the page was deallocated and not allocated again. Reads a bitmap without taking a latch, so that
+   * every buffer pool miss can ask.
+   */
+  auto IsPageFree(page_id_t page_id) const -> bool;
+
+  /** @return the number of free pages */
+  auto GetNumFreePages() -> size_t;
+
+  /**
+   * Release the disk space of free pages while the database stays online: free pages at the end of the file are cut
+   * off, the others become holes that read as zeros. Page ids do not change. The file is not truncated while it is
+   * mapped by MapReadOnly.
+   * @return the number of bytes given back to the file system
+   */
+  virtual auto CompactFile() -> uint64_t;
 
   /**
    * Flush the entire log buffer into disk.
@@ -71,6 +186,20 @@ class DiskManager {
    */
   auto ReadLog(char *log_data, int size, int offset) -> bool;
 
+  /**
+   * Map the database file read-only into memory, for buffer pools that use the pages in place. The mapping is created
+   * on the first call and stays valid until ShutDown. Pages appended to the file afterwards are not part of it.
+   * @param[out] num_pages number of whole pages in the mapping
+   * @return the start of the mapping, or nullptr if the file is empty or cannot be mapped
+   */
+  virtual auto MapReadOnly(size_t *num_pages) -> const char *;
+
+  /** @return true if page I/O bypasses the kernel page cache */
+  auto IsDirectIO() const -> bool { return direct_io_; }
+
+  /** Buffers and file offsets of direct page I/O must be aligned to this many bytes. */
+  static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
 
@@ -80,6 +209,47 @@ class DiskManager {
   /** @return the number of disk writes */
   auto GetNumWrites() const -> int;
 
+  /** @return the number of page reads */
+  auto GetNumReads() const -> int;
+
+  /**
+   * Set the handler that repairs pages failing checksum verification. It is called from the thread reading the page,
+   * without any latch of the disk manager held, and may read the log.
+   * @param handler the repair handler, or nullptr to only report corrupt pages
+   */
+  void SetPageRepairHandler(page_repair_fn handler);
+
+  /**
+   * Turn checksums on or off; they are on by default. Pages written while checksums are off are not verified when
+   * they are read.
+   * @param enabled true to checksum pages
+   */
+  void SetChecksums(bool enabled) { checksums_enabled_ = enabled; }
+
+  /** @return the number of page reads that failed checksum verification, repaired or not */
+  auto GetNumChecksumFailures() const -> uint64_t { return num_checksum_failures_; }
+
+  /**
+   * Turn the double-write buffer for WritePage and SubmitRequests on or off; it is off by default. A write, of a
+   * single page or a batch, then costs one more sequential write and two syncs, and its pages are durable when it
+   * returns. Batches amortize this over their pages. CompressedDiskManager, which never writes a page in place, does
+   * not use it.
+   * @param enabled true to write pages through the double-write buffer
+   */
+  void SetDoubleWrite(bool enabled) { double_write_enabled_ = enabled; }
+
+  /** @return the number of torn pages restored from the double-write buffer when the file was opened */
+  auto GetNumDoubleWriteRepairs() const -> uint64_t { return num_double_write_repairs_; }
+
+  /** @return the pages that failed checksum verification and could not be repaired, in no particular order */
+  auto GetCorruptPages() -> std::vector<page_id_t>;
+
+  /**
+   * @return the checksum of a page image. Never 0, which stands for a page without a checksum, so that pages written
+   * before checksums were turned on, and holes, are not taken for corrupt.
+   */
+  static auto ComputeChecksum(const char *page_data) -> uint32_t;
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -89,20 +259,181 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline auto HasFlushLogFuture() -> bool { return flush_log_f_ != nullptr; }
 
+ protected:
+  // file descriptor of the db file, -1 after ShutDown
+  int db_fd_;
+  std::atomic<int> num_writes_;
+  std::atomic<int> num_reads_;
+
+  /** @return the number of bytes of disk space allocated to the db file */
+  auto GetAllocatedBytes() -> uint64_t;
+
+  /** @return true if pages are checksummed on write */
+  auto ChecksumsEnabled() const -> bool { return checksums_enabled_; }
+
+  /**
+   * Deal with a page whose checksum does not match: count it, zero the page, and hand it to the repair handler. The
+   * caller writes a repaired page back, which stamps a new checksum.
+   * @param page_id id of the page
+   * @param[in,out] page_data the page as read; zeros or the repaired page on return
+   * @return true if the page was repaired
+   */
+  auto HandleChecksumMismatch(page_id_t page_id, char *page_data) -> bool;
+
  private:
   auto GetFileSize(const std::string &file_name) -> int;
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  /**
+   * Read a run of consecutive pages, starting at page_id, with a single system call.
+   * @param page_id id of the first page
+   * @param buffers one PAGE_SIZE output buffer per page
+   * @param num_pages number of pages in the run
+   * @return false if a page failed verification and could not be repaired
+   */
+  auto ReadPages(page_id_t page_id, char *const *buffers, size_t num_pages) -> bool;
+
+  /**
+   * Write a run of consecutive pages, starting at page_id, with a single system call.
+   * @param page_id id of the first page
+   * @param buffers one PAGE_SIZE buffer per page
+   * @param num_pages number of pages in the run
+   * @param double_written true if the pages are in the double-write buffer, which covers their checksums until the
+   * batch is finished; otherwise the checksums go through BeginChecksumUpdate
+   */
+  void WritePages(page_id_t page_id, const char *const *buffers, size_t num_pages, bool double_written);
+
+  /** @return true if every buffer can be handed to the kernel as is */
+  auto CanUseBuffers(const char *const *buffers, size_t num_pages) const -> bool;
+
+  /** Set or clear the bit of a page in the free page map file. Must be called with free_latch_ held. */
+  void WriteFreeMapBit(page_id_t page_id, bool is_free);
+
+  /** Set or clear the bit of a page in free_bits_. Must be called with free_latch_ held. */
+  void SetFreeBit(page_id_t page_id, bool is_free);
+
+  /**
+   * @param page_id id of a page
+   * @param create true to allocate the chunk holding the slot if there is none yet
+   * @return the checksum slot of the page, nullptr if its chunk does not exist and create is false
+   */
+  auto GetChecksumSlot(page_id_t page_id, bool create) -> std::atomic<uint64_t> *;
+
+  /**
+   * Get ready to change the checksums of a run of pages outside the double-write buffer: clear the entries that hold
+   * a checksum in the checksum file and sync it, so that a crash during the page writes leaves no stale checksum, and
+   * mark the pages pending until PersistChecksums. Pages that are pending already cost nothing.
+   * @param page_id id of the first page
+   * @param num_pages number of pages in the run
+   */
+  void BeginChecksumUpdate(page_id_t page_id, size_t num_pages);
+
+  /**
+   * Record the checksums of a run of pages in memory.
+   * @param page_id id of the first page
+   * @param checksums one checksum per page, 0 to clear it
+   * @param num_pages number of pages in the run
+   */
+  void RecordChecksums(page_id_t page_id, const uint32_t *checksums, size_t num_pages);
+
+  /** Write the checksums of a run of pages to the checksum file, without syncing it. */
+  void WriteChecksumEntries(page_id_t page_id, const uint32_t *checksums, size_t num_pages);
+
+  /** @return the checksum of the last write of a page, 0 if it has none */
+  auto GetStoredChecksum(page_id_t page_id) -> uint32_t;
+
+  /**
+   * Sync the db file, then write the checksums of the pending pages and sync the checksum file. Must not run
+   * concurrently with page writes.
+   */
+  void PersistChecksums();
+
+  /**
+   * Write the pages of a batch to the double-write buffer and sync it, before they are written in place. Must be
+   * called with double_write_latch_ held.
+   * @param requests the batch, writes and reads
+   */
+  void WriteDoubleWriteBuffer(const std::vector<DiskRequest> &requests);
+
+  /**
+   * Sync the pages written in place and their checksums, then mark the double-write buffer empty. Must be called
+   * with double_write_latch_ held.
+   */
+  void FinishDoubleWrite();
+
+  /** Restore the pages that were torn in place from the double-write buffer left by the last run, if any. */
+  void RecoverFromDoubleWriteBuffer();
+
+  /** Start of the double-write buffer file. The header is followed by one entry per page, then the pages. */
+  struct DoubleWriteHeader {
+    uint32_t magic_;
+    uint32_t num_pages_;
+    /** CRC32C of num_pages_ and the entries. */
+    uint32_t checksum_;
+    uint32_t reserved_;
+  };
+
+  /** Where a page of the double-write buffer belongs, and its checksum. */
+  struct DoubleWriteEntry {
+    page_id_t page_id_;
+    uint32_t checksum_;
+  };
+
+  static constexpr uint32_t DOUBLE_WRITE_MAGIC = 0x42445742;
+
+  // free page map: the ids of free pages, split by page_id % free_num_instances_ so that every buffer pool instance
+  // finds its own quickly, and their persistent bitmap, file descriptor -1 until the bitmap is first written
+  std::vector<std::set<page_id_t>> free_pages_{1};
+  uint32_t free_num_instances_ = 1;
+  std::vector<uint8_t> free_map_;
+  int free_map_fd_ = -1;
+  std::string free_map_name_;
+  std::mutex free_latch_;
+  // the free page set once more, as a bitmap that IsPageFree reads without free_latch_: chunks of FREE_BITS_PER_CHUNK
+  // bits, allocated when the first page of their range is freed and kept until the disk manager is destroyed
+  static constexpr size_t FREE_BITS_PER_CHUNK = size_t{1} << 20;
+  std::array<std::atomic<std::atomic<uint64_t> *>, (size_t{1} << 31) / FREE_BITS_PER_CHUNK> free_bits_{};
+  // one past the highest page id allocated so far, see IsAllocatedPage
+  std::atomic<page_id_t> page_high_water_{0};
+  // page checksums, read and written without a latch: one slot per page, in chunks of CHECKSUMS_PER_CHUNK allocated
+  // when the first page of their range gets a checksum. The low 32 bits of a slot hold the checksum of the last write
+  // of the page, CHECKSUM_PENDING is set while its entry in the checksum file is cleared, see BeginChecksumUpdate
+  static constexpr size_t CHECKSUMS_PER_CHUNK = size_t{1} << 16;
+  static constexpr uint64_t CHECKSUM_PENDING = uint64_t{1} << 32;
+  std::array<std::atomic<std::atomic<uint64_t> *>, (size_t{1} << 31) / CHECKSUMS_PER_CHUNK> checksums_{};
+  // the checksum file, file descriptor -1 if it cannot be opened
+  std::atomic<int> checksum_fd_{-1};
+  std::string checksum_name_;
+  // protects the pending pages, and orders clearing their entries with PersistChecksums
+  std::mutex checksum_latch_;
+  std::vector<page_id_t> pending_checksum_pages_;
+  std::atomic<bool> checksums_enabled_{true};
+  std::atomic<uint64_t> num_checksum_failures_{0};
+  // double-write buffer file, file descriptor -1 until the first batch is written through it
+  int double_write_fd_ = -1;
+  std::string double_write_name_;
+  std::mutex double_write_latch_;
+  std::atomic<bool> double_write_enabled_{false};
+  std::atomic<uint64_t> num_double_write_repairs_{0};
+  // pages that failed verification and were not repaired, and the handler that repairs them
+  std::unordered_set<page_id_t> corrupt_pages_;
+  page_repair_fn repair_handler_;
+  std::mutex repair_latch_;
+  // serializes log reads and writes, which share the stream, e.g. a page repair reading the log during a flush
+  std::mutex log_latch_;
+  // held shared by page writes and exclusively by CompactFile, so that truncation never cuts off a write
+  std::shared_mutex resize_latch_;
+  // read-only mapping of the db file created by MapReadOnly, nullptr if there is none
+  char *mapped_data_ = nullptr;
+  size_t mapped_size_ = 0;
+  std::mutex map_latch_;
+  // true if the db file was opened with O_DIRECT
+  bool direct_io_;
   std::string file_name_;
   int num_flushes_;
-  int num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
 };
 
 }  // namespace bustub
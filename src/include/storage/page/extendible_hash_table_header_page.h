@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extendible_hash_table_header_page.h
+//
+// Identification: src/include/storage/page/extendible_hash_table_header_page.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdlib>
+
+#include "common/config.h"
+#include "storage/page/hash_table_page_defs.h"
+
+namespace bustub {
+
+/**
+ *
+ * Header Page for extendible hash table.
+ *
+ * The header page maps the top `depth` bits of a hash to a directory page, and each directory maps the low bits of
+ * the hash to a bucket with its own global depth. The depth of the header is fixed when the table is created;
+ * directory pages are created when the first key of their slot is inserted.
+ *
+ * Header format (size in byte):
+ * --------------------------------------------------------------------------
+ * | LSN (4) | PageId(4) | Depth(4) | DirectoryPageIds(PAGE_SIZE / 2) | Free
+ * --------------------------------------------------------------------------
+ */
+class ExtendibleHashTableHeaderPage {
+ public:
+  /**
+   * Initializes a new header page, all of whose slots have no directory.
+   *
+   * @param page_id the page id of the header page
+   * @param depth the number of top hash bits that select the directory, at most HEADER_MAX_DEPTH
+   */
+  void Init(page_id_t page_id, uint32_t depth);
+
+  /**
+   * @return the page ID of this page
+   */
+  auto GetPageId() const -> page_id_t;
+
+  /**
+   * @return the lsn of this page
+   */
+  auto GetLSN() const -> lsn_t;
+
+  /**
+   * Sets the LSN of this page
+   *
+   * @param lsn the log sequence number to which to set the lsn field
+   */
+  void SetLSN(lsn_t lsn);
+
+  /**
+   * @return the number of top hash bits that select the directory
+   */
+  auto GetDepth() const -> uint32_t;
+
+  /**
+   * @return the number of directory slots
+   */
+  auto Size() const -> uint32_t;
+
+  /**
+   * Maps a hash to the slot of its directory, using the top GetDepth() bits of the hash. Directories use the low bits
+   * of the hash, so the two never overlap.
+   *
+   * @param hash the hash of a key
+   * @return the directory slot of the hash
+   */
+  auto HashToDirectoryIndex(uint32_t hash) const -> uint32_t;
+
+  /**
+   * @param directory_idx the directory slot to look up
+   * @return the page id of the directory in the slot, INVALID_PAGE_ID if it has none yet
+   */
+  auto GetDirectoryPageId(uint32_t directory_idx) const -> page_id_t;
+
+  /**
+   * Sets the directory page of a slot
+   *
+   * @param directory_idx the directory slot to update
+   * @param directory_page_id the page id of the directory
+   */
+  void SetDirectoryPageId(uint32_t directory_idx, page_id_t directory_page_id);
+
+ private:
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t depth_;
+  page_id_t directory_page_ids_[HEADER_ARRAY_SIZE];
+};
+
+static_assert(sizeof(ExtendibleHashTableHeaderPage) <= PAGE_SIZE);
+static_assert(2 * HEADER_MAX_DEPTH <= 32, "the header and directory bits of a hash must not overlap");
+
+}  // namespace bustub
@@ -33,6 +33,12 @@ namespace bustub {
  *  The above format omits the space required for the occupied_ and
  *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
  *
+ *  When built with BUSTUB_HASH_FINGERPRINTS, the page also keeps one byte of a
+ *  hash of every key in fingerprints_. Lookups compare a whole group of
+ *  fingerprints with one SSE2 or AVX2 instruction and only call the comparator
+ *  on slots whose fingerprint matches. The fingerprint is computed from the key
+ *  bytes, so keys that compare equal must have the same bytes, as the hash
+ *  functions of the hash table already assume.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class HashTableBucketPage {
@@ -45,7 +51,7 @@ class HashTableBucketPage {
    *
    * @return true if at least one key matched
    */
-  auto GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool;
+  auto GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const -> bool;
 
   /**
    * Attempts to insert a key and value in the bucket.  Uses the occupied_
@@ -120,17 +126,22 @@ class HashTableBucketPage {
   /**
    * @return the number of readable elements, i.e. current size
    */
-  auto NumReadable() -> uint32_t;
+  auto NumReadable() const -> uint32_t;
 
   /**
    * @return whether the bucket is full
    */
-  auto IsFull() -> bool;
+  auto IsFull() const -> bool;
 
   /**
    * @return whether the bucket is empty
    */
-  auto IsEmpty() -> bool;
+  auto IsEmpty() const -> bool;
+
+  /**
+   * Prefetches the bitmaps (and fingerprints) into the CPU cache, i.e. what a lookup reads before it compares keys.
+   */
+  void Prefetch() const;
 
   /**
    * Prints the bucket's occupancy information
@@ -138,10 +149,29 @@ class HashTableBucketPage {
   void PrintBucket();
 
  private:
+#if BUSTUB_HASH_FINGERPRINTS
+  /** @return the fingerprint byte of a key */
+  static auto Fingerprint(const KeyType &key) -> uint8_t;
+
+  /**
+   * @param bitmap occupied_ or readable_
+   * @param group index of a group of BUCKET_GROUP_SIZE slots
+   * @return the bits of the group's slots, slot i of the group in bit i
+   */
+  static auto GroupBits(const char *bitmap, uint32_t group) -> uint32_t;
+
+  /** @return a bit for every readable slot of the group whose fingerprint equals the given one */
+  auto MatchGroup(uint32_t group, uint8_t fingerprint) const -> uint32_t;
+#endif
+
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
-  char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char occupied_[BUCKET_BITMAP_SIZE];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
-  char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char readable_[BUCKET_BITMAP_SIZE];
+#if BUSTUB_HASH_FINGERPRINTS
+  // Fingerprint of the key in each slot; only meaningful for readable slots.
+  uint8_t fingerprints_[BUCKET_NUM_GROUPS * BUCKET_GROUP_SIZE];
+#endif
   MappingType array_[1];
 };
 
@@ -32,7 +32,21 @@
  * Extendible Hashing Definitions
  */
 #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
-#define DIRECTORY_ARRAY_SIZE 512
+
+/**
+ * DIRECTORY_ARRAY_SIZE is the number of slots in an extendible hashing directory page. It is the largest power of two
+ * for which the 12 byte header and a local depth (1 byte) and bucket page id (4 bytes) per slot fit in a page: 5 *
+ * PAGE_SIZE / 8 + 12 <= PAGE_SIZE for every page size of at least 32 bytes, while twice as many slots never fit.
+ */
+#define DIRECTORY_ARRAY_SIZE (PAGE_SIZE / 8)
+
+/**
+ * HEADER_ARRAY_SIZE is the number of directory page ids in an extendible hashing header page, a power of two for the
+ * same reason as DIRECTORY_ARRAY_SIZE: the 12 byte header and a page id (4 bytes) per slot fit in PAGE_SIZE / 2 + 12
+ * bytes. HEADER_MAX_DEPTH is its base two logarithm, the most hash bits a header page can map to directories.
+ */
+#define HEADER_ARRAY_SIZE (PAGE_SIZE / 8)
+#define HEADER_MAX_DEPTH (__builtin_ctz(HEADER_ARRAY_SIZE))
 
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
@@ -41,4 +55,17 @@
  * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
  * to maintain the occupied and readable flags for a key value pair.
  */
+#if BUSTUB_HASH_FINGERPRINTS
+/**
+ * With fingerprints every pair also takes a fingerprint byte, so 4 * (PAGE_SIZE - 64) / (4 * sizeof(MappingType) + 5).
+ * The fingerprint array and the bitmaps are rounded up to whole groups of BUCKET_GROUP_SIZE slots, which lookups
+ * compare at once; the 64 bytes held back cover that rounding and the alignment of the pair array.
+ */
+#define BUCKET_ARRAY_SIZE (4 * (PAGE_SIZE - 64) / (4 * sizeof(MappingType) + 5))
+#define BUCKET_GROUP_SIZE 32
+#define BUCKET_NUM_GROUPS ((BUCKET_ARRAY_SIZE - 1) / BUCKET_GROUP_SIZE + 1)
+#define BUCKET_BITMAP_SIZE (BUCKET_NUM_GROUPS * BUCKET_GROUP_SIZE / 8)
+#else
 #define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_BITMAP_SIZE ((BUCKET_ARRAY_SIZE - 1) / 8 + 1)
+#endif
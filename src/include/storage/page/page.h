@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -24,14 +25,21 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * The page data itself is not part of the Page object: it lives in a PAGE_SIZE slot of the frame memory owned by the
+ * buffer pool, which keeps every slot aligned for direct I/O, or in a read-only mapping of the database file for an
+ * MmapBufferPoolManager. Get at it with GetData(); a Page pointer and its data pointer are different addresses.
  */
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
+  friend class MmapBufferPoolManager;
+  // Log recovery rebuilds damaged pages in buffers of its own.
+  friend class LogRecovery;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. The buffer pool attaches the page to its frame memory. */
+  Page() = default;
 
   /** Default destructor. */
   ~Page() = default;
@@ -78,14 +86,14 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The actual data that is stored within a page: this page's slot in the buffer pool's frame memory. */
+  char *data_ = nullptr;
+  /** The ID of this page. Atomic so that the background writer can inspect frames without the instance latch. */
+  std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
+  /** The pin count of this page. Atomic so that buffer pool hits can pin without the instance latch. */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
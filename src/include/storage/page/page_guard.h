@@ -0,0 +1,200 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard owns one pin on a page and drops it when it goes out of scope, so that a pin cannot leak on an early
+ * return. It keeps the frame the page lives in, and the pin is dropped through BufferPoolManager::UnpinFrame, without
+ * looking the page up again. Guards are move-only; a moved-from or dropped guard is empty and releases nothing.
+ *
+ * A basic guard takes no page latch. Use it where the page is protected otherwise, e.g. by a latch on the whole data
+ * structure; ReadPageGuard and WritePageGuard also hold the page latch.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * Take over a pin on a page.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, or nullptr for an empty guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  auto operator=(const BasicPageGuard &) -> BasicPageGuard & = delete;
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+  auto operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard &;
+
+  /** Drops the pin, if the guard still holds one. */
+  ~BasicPageGuard() { Drop(); }
+
+  /** Drop the pin now, before the guard goes out of scope. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  explicit operator bool() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  auto PageId() const -> page_id_t { return page_->GetPageId(); }
+
+  /** @return the guarded page, e.g. to use it as a TablePage */
+  auto GetPage() const -> Page * { return page_; }
+
+  /** @return the page data, for reading */
+  auto GetData() const -> const char * { return page_->GetData(); }
+
+  /** @return the page data, for writing; the page is written back when the guard is dropped */
+  auto GetDataMut() -> char * {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  /** @return the page data as a T, e.g. a HashTableDirectoryPage, for reading */
+  template <class T>
+  auto As() const -> const T * {
+    return reinterpret_cast<const T *>(GetData());
+  }
+
+  /** @return the page data as a T, for writing */
+  template <class T>
+  auto AsMut() -> T * {
+    return reinterpret_cast<T *>(GetDataMut());
+  }
+
+  /** Mark the page dirty without going through GetDataMut, e.g. after modifying it through GetPage. */
+  void SetDirty() { is_dirty_ = true; }
+
+  /**
+   * Latch the page in read mode and hand the pin over to a ReadPageGuard, e.g. to pin a page under one latch and
+   * latch it after releasing that one. This guard is empty afterwards.
+   * @return the read guard, empty if this guard was
+   */
+  auto UpgradeRead() -> ReadPageGuard;
+
+  /**
+   * Latch the page in write mode and hand the pin over to a WritePageGuard. This guard is empty afterwards.
+   * @return the write guard, empty if this guard was
+   */
+  auto UpgradeWrite() -> WritePageGuard;
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_ = nullptr;
+  Page *page_ = nullptr;
+  bool is_dirty_ = false;
+};
+
+/** ReadPageGuard owns a pin on a page and its read latch, and releases both when it goes out of scope. */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * Take over a pin on a page and latch it in read mode.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, or nullptr for an empty guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page);
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  auto operator=(ReadPageGuard &&that) noexcept -> ReadPageGuard &;
+
+  /** Releases the latch and the pin, if the guard still holds them. */
+  ~ReadPageGuard() { Drop(); }
+
+  /** Release the latch and the pin now. */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  template <class T>
+  auto As() const -> const T * {
+    return guard_.As<T>();
+  }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard owns a pin on a page and its write latch, and releases both when it goes out of scope. The page is
+ * unpinned dirty if it was accessed through GetDataMut or AsMut, or marked with SetDirty.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * Take over a pin on a page and latch it in write mode.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, or nullptr for an empty guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page);
+
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  auto operator=(WritePageGuard &&that) noexcept -> WritePageGuard &;
+
+  /** Releases the latch and the pin, if the guard still holds them. */
+  ~WritePageGuard() { Drop(); }
+
+  /** Release the latch and the pin now. */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  auto GetDataMut() -> char * { return guard_.GetDataMut(); }
+
+  template <class T>
+  auto As() const -> const T * {
+    return guard_.As<T>();
+  }
+
+  template <class T>
+  auto AsMut() -> T * {
+    return guard_.AsMut<T>();
+  }
+
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -21,6 +21,7 @@
 namespace bustub {
 
 class TableHeap;
+class TablePage;
 
 /**
  * TableIterator enables the sequential scan of a TableHeap.
@@ -32,7 +33,10 @@ class TableIterator {
   TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        pages_until_read_ahead_(other.pages_until_read_ahead_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -54,13 +58,22 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    pages_until_read_ahead_ = other.pages_until_read_ahead_;
     return *this;
   }
 
+  /** How many pages along the page chain are read ahead of the scan. */
+  static constexpr size_t READ_AHEAD_PAGES = 16;
+
  private:
+  /** Ask the buffer pool to read the READ_AHEAD_PAGES pages that follow page. */
+  void ReadAhead(TablePage *page);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Pages left before the next read-ahead request, 0 before the first one. */
+  size_t pages_until_read_ahead_{0};
 };
 
 }  // namespace bustub
@@ -33,6 +33,8 @@ void LogManager::RunFlushThread() {
                 std::swap(log_buffer_, flush_buffer_);
                 memset(log_buffer_, 0, LOG_BUFFER_SIZE);
                 disk_manager_->WriteLog(flush_buffer_, buffer_offset_);
+                // the records are on disk now; the next flush must not write them (or the zeroed buffer) again
+                buffer_offset_ = 0;
                 append_cv_.notify_all();
                 SetPersistentLSN(GetNextLSN()-1);
             }
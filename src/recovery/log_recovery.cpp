@@ -12,23 +12,29 @@
 
 #include "recovery/log_recovery.h"
 
+#include <vector>
+
 #include "storage/page/table_page.h"
-#include <iostream>
+
 namespace bustub {
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool { 
-    if (data + LogRecord::HEADER_SIZE > log_buffer_ + LOG_BUFFER_SIZE)
+auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool {
+  return DeserializeLogRecord(data, log_buffer_ + LOG_BUFFER_SIZE, log_record);
+}
+
+auto LogRecovery::DeserializeLogRecord(const char *data, const char *buffer_end, LogRecord *log_record) -> bool {
+    if (data + LogRecord::HEADER_SIZE > buffer_end)
         return false;
     memcpy(&log_record->size_, data, 4);
     memcpy(&log_record->lsn_, data + 4, 4);
     memcpy(&log_record->txn_id_, data + 8, 4);
     memcpy(&log_record->prev_lsn_, data + 12, 4);
     memcpy(&log_record->log_record_type_, data + 16, 4);
-    if (log_record->GetSize() + data > log_buffer_ + LOG_BUFFER_SIZE || log_record->GetSize() <= 0)
+    if (log_record->GetSize() + data > buffer_end || log_record->GetSize() <= 0)
         return false;
     
     data += LogRecord::HEADER_SIZE;
@@ -68,7 +74,6 @@ auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
     default:
         break;
     }
-    std::cout<<log_record->ToString()<<std::endl;
     return true;
 }
 
@@ -149,11 +154,88 @@ void LogRecovery::Redo() {
             }
             buffer_pool_manager_->UnpinPage(record.page_id_, need_redo);
         }
+        if (buffer_offset == 0) {
+            // the rest of the log is not a record, e.g. zeros after a torn log write
+            break;
+        }
         offset_ += buffer_offset;
     }
     
 }
 
+/*
+ * Rebuild one table page from the whole log: start from an empty image and apply, in log order, every record that
+ * touches the page. Nothing is compared against the page LSN, since the image on disk cannot be trusted. Reads the
+ * log into a buffer of its own, so that it can run while Redo is fetching pages. The operations are applied without
+ * a transaction, so they neither lock nor log, and the repair works while the system is running as well.
+ */
+auto LogRecovery::RedoPage(page_id_t page_id, char *page_data) -> bool {
+  std::vector<char> buffer(LOG_BUFFER_SIZE);
+  Page scratch;
+  scratch.data_ = page_data;
+  auto page = reinterpret_cast<TablePage *>(&scratch);
+  bool created = false;
+  int offset = 0;
+  while (disk_manager_->ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset)) {
+    int buffer_offset = 0;
+    LogRecord record;
+    while (DeserializeLogRecord(buffer.data() + buffer_offset, buffer.data() + LOG_BUFFER_SIZE, &record)) {
+      buffer_offset += record.GetSize();
+      RID rid;
+      switch (record.GetLogRecordType()) {
+        case LogRecordType::NEWPAGE:
+          if (record.page_id_ == page_id) {
+            page->Init(page_id, PAGE_SIZE, record.prev_page_id_, nullptr, nullptr);
+            created = true;
+          } else if (created && record.prev_page_id_ == page_id) {
+            page->SetNextPageId(record.page_id_);
+          } else {
+            continue;
+          }
+          break;
+        case LogRecordType::INSERT:
+          rid = record.GetInsertRID();
+          if (!created || rid.GetPageId() != page_id) {
+            continue;
+          }
+          page->InsertTuple(record.GetInsertTuple(), &rid, nullptr, nullptr, nullptr);
+          break;
+        case LogRecordType::APPLYDELETE:
+        case LogRecordType::MARKDELETE:
+        case LogRecordType::ROLLBACKDELETE:
+          rid = record.GetDeleteRID();
+          if (!created || rid.GetPageId() != page_id) {
+            continue;
+          }
+          if (record.GetLogRecordType() == LogRecordType::APPLYDELETE) {
+            page->ApplyDelete(rid, nullptr, nullptr);
+          } else if (record.GetLogRecordType() == LogRecordType::MARKDELETE) {
+            page->MarkDelete(rid, nullptr, nullptr, nullptr);
+          } else {
+            page->RollbackDelete(rid, nullptr, nullptr);
+          }
+          break;
+        case LogRecordType::UPDATE:
+          rid = record.GetUpdateRID();
+          if (!created || rid.GetPageId() != page_id) {
+            continue;
+          }
+          page->UpdateTuple(record.GetUpdateTuple(), &record.GetOriginalTuple(), rid, nullptr, nullptr, nullptr);
+          break;
+        default:
+          continue;
+      }
+      page->SetLSN(record.GetLSN());
+    }
+    if (buffer_offset == 0) {
+      // the rest of the log is not a record, e.g. zeros after a torn log write
+      break;
+    }
+    offset += buffer_offset;
+  }
+  return created;
+}
+
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
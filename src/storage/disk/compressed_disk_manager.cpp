@@ -0,0 +1,262 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.cpp
+//
+// Identification: src/storage/disk/compressed_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_disk_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "common/logger.h"
+#include "common/util/lz4_codec.h"
+
+namespace bustub {
+
+/** Write a whole buffer at an offset, retrying until every byte is written. @return false on an I/O error */
+static auto WriteFully(int fd, const char *data, size_t size, uint64_t offset) -> bool {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+/** Read up to size bytes at an offset. @return the number of bytes read, less than size only at the end of the file */
+static auto ReadFully(int fd, char *data, size_t size, uint64_t offset) -> size_t {
+  size_t total = 0;
+  while (total < size) {
+    ssize_t read_count = pread(fd, data + total, size - total, static_cast<off_t>(offset + total));
+    if (read_count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read_count <= 0) {
+      break;
+    }
+    total += read_count;
+  }
+  return total;
+}
+
+CompressedDiskManager::CompressedDiskManager(const std::string &db_file) : DiskManager(db_file) { LoadExtentMap(); }
+
+void CompressedDiskManager::LoadExtentMap() {
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0) {
+    return;
+  }
+  auto file_size = static_cast<uint64_t>(stat_buf.st_size);
+  uint64_t offset = 0;
+  RecordHeader header;
+  while (offset + sizeof(header) <= file_size) {
+    ReadFully(db_fd_, reinterpret_cast<char *>(&header), sizeof(header), offset);
+    if (header.magic_ != RECORD_MAGIC || header.num_sectors_ == 0 ||
+        header.num_sectors_ * SECTOR_SIZE > MAX_RECORD_SIZE) {
+      // Not a record, e.g. the torn end of an interrupted write. Skip the sector and reuse it later.
+      free_extents_[1].push_back(offset);
+      offset += SECTOR_SIZE;
+      continue;
+    }
+    Extent extent{offset, header.num_sectors_, header.sequence_};
+    next_sequence_ = std::max(next_sequence_, header.sequence_ + 1);
+    offset += header.num_sectors_ * SECTOR_SIZE;
+    RecordAllocatedPage(header.page_id_);
+    if (IsPageFree(header.page_id_)) {
+      free_extents_[extent.num_sectors_].push_back(extent.offset_);
+      continue;
+    }
+    auto [iter, inserted] = extents_.emplace(header.page_id_, extent);
+    if (!inserted) {
+      // Keep the newer version of the page and reuse the extent of the older one.
+      Extent &current = iter->second;
+      const Extent &stale = current.sequence_ > extent.sequence_ ? extent : current;
+      free_extents_[stale.num_sectors_].push_back(stale.offset_);
+      if (extent.sequence_ > current.sequence_) {
+        current = extent;
+      }
+    }
+  }
+  end_offset_ = offset;
+}
+
+void CompressedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  alignas(RecordHeader) static thread_local char record[MAX_RECORD_SIZE];
+  char *data = record + sizeof(RecordHeader);
+  // A page that does not shrink by at least a sector is not worth decompressing.
+  int data_size = Lz4Codec::Compress(page_data, data, PAGE_SIZE, PAGE_SIZE - SECTOR_SIZE);
+  if (data_size <= 0) {
+    memcpy(data, page_data, PAGE_SIZE);
+    data_size = PAGE_SIZE;
+  }
+  auto num_sectors = static_cast<uint32_t>((sizeof(RecordHeader) + data_size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+  memset(data + data_size, 0, num_sectors * SECTOR_SIZE - sizeof(RecordHeader) - data_size);
+
+  Extent extent;
+  {
+    std::scoped_lock latch(latch_);
+    extent = {AllocateExtent(num_sectors), num_sectors, next_sequence_++};
+  }
+  uint32_t checksum = ChecksumsEnabled() ? ComputeChecksum(page_data) : 0;
+  RecordHeader header{RECORD_MAGIC, page_id, static_cast<uint32_t>(data_size), num_sectors, extent.sequence_, checksum};
+  memcpy(record, &header, sizeof(header));
+  num_writes_ += 1;
+  RecordAllocatedPage(page_id);
+  if (!WriteFully(db_fd_, record, num_sectors * SECTOR_SIZE, extent.offset_)) {
+    LOG_DEBUG("I/O error while writing");
+  }
+
+  std::scoped_lock latch(latch_);
+  auto [iter, inserted] = extents_.emplace(page_id, extent);
+  if (inserted) {
+    return;
+  }
+  // Two writes of the same page may finish out of order; the one that started last is the current version.
+  Extent &current = iter->second;
+  if (current.sequence_ > extent.sequence_) {
+    free_extents_[extent.num_sectors_].push_back(extent.offset_);
+  } else {
+    free_extents_[current.num_sectors_].push_back(current.offset_);
+    current = extent;
+  }
+}
+
+auto CompressedDiskManager::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  alignas(RecordHeader) static thread_local char record[MAX_RECORD_SIZE];
+  num_reads_ += 1;
+  while (true) {
+    Extent extent;
+    {
+      std::scoped_lock latch(latch_);
+      auto iter = extents_.find(page_id);
+      if (iter == extents_.end()) {
+        LOG_DEBUG("Read less than a page");
+        memset(page_data, 0, PAGE_SIZE);
+        return true;
+      }
+      extent = iter->second;
+    }
+    size_t size = ReadFully(db_fd_, record, extent.num_sectors_ * SECTOR_SIZE, extent.offset_);
+
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    // A write of this page may have moved it and handed the extent to another page since the lookup. The header tells.
+    if (size < sizeof(header) || header.magic_ != RECORD_MAGIC || header.page_id_ != page_id ||
+        header.sequence_ != extent.sequence_) {
+      std::scoped_lock latch(latch_);
+      auto iter = extents_.find(page_id);
+      if (iter != extents_.end() && iter->second.sequence_ != extent.sequence_) {
+        continue;
+      }
+      LOG_DEBUG("corrupt page record");
+      memset(page_data, 0, PAGE_SIZE);
+      return false;
+    }
+    const char *data = record + sizeof(RecordHeader);
+    bool is_corrupt = false;
+    if (header.data_size_ == PAGE_SIZE) {
+      memcpy(page_data, data, PAGE_SIZE);
+    } else if (Lz4Codec::Decompress(data, page_data, static_cast<int>(header.data_size_), PAGE_SIZE) != PAGE_SIZE) {
+      LOG_DEBUG("corrupt compressed page");
+      is_corrupt = true;
+    }
+    if (ChecksumsEnabled() && header.checksum_ != 0) {
+      is_corrupt = is_corrupt || ComputeChecksum(page_data) != header.checksum_;
+      if (is_corrupt) {
+        if (!HandleChecksumMismatch(page_id, page_data)) {
+          return false;
+        }
+        WritePage(page_id, page_data);
+      }
+    } else if (is_corrupt) {
+      memset(page_data, 0, PAGE_SIZE);
+      return false;
+    }
+    return true;
+  }
+}
+
+void CompressedDiskManager::SubmitRequests(std::vector<DiskRequest> *requests) {
+  for (const DiskRequest &request : *requests) {
+    if (request.is_write_) {
+      WritePage(request.page_id_, request.data_);
+    } else {
+      ReadPage(request.page_id_, request.data_);
+    }
+  }
+}
+
+auto CompressedDiskManager::DeallocatePage(page_id_t page_id) -> bool {
+  if (!DiskManager::DeallocatePage(page_id)) {
+    return false;
+  }
+  std::scoped_lock latch(latch_);
+  auto iter = extents_.find(page_id);
+  if (iter != extents_.end()) {
+    free_extents_[iter->second.num_sectors_].push_back(iter->second.offset_);
+    extents_.erase(iter);
+  }
+  return true;
+}
+
+auto CompressedDiskManager::CompactFile() -> uint64_t {
+  std::scoped_lock latch(latch_);
+  uint64_t allocated_bytes = GetAllocatedBytes();
+  for (const auto &[num_sectors, offsets] : free_extents_) {
+    for (uint64_t offset : offsets) {
+      if (fallocate(db_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset),
+                    static_cast<off_t>(num_sectors * SECTOR_SIZE)) != 0) {
+        LOG_DEBUG("can't punch a hole into db file");
+      }
+    }
+  }
+  uint64_t compacted_bytes = GetAllocatedBytes();
+  return allocated_bytes > compacted_bytes ? allocated_bytes - compacted_bytes : 0;
+}
+
+auto CompressedDiskManager::MapReadOnly(size_t *num_pages) -> const char * {
+  *num_pages = 0;
+  return nullptr;
+}
+
+auto CompressedDiskManager::GetStoredBytes() -> uint64_t {
+  std::scoped_lock latch(latch_);
+  uint64_t bytes = 0;
+  for (const auto &[page_id, extent] : extents_) {
+    bytes += extent.num_sectors_ * SECTOR_SIZE;
+  }
+  return bytes;
+}
+
+auto CompressedDiskManager::AllocateExtent(uint32_t num_sectors) -> uint64_t {
+  auto &free_offsets = free_extents_[num_sectors];
+  if (!free_offsets.empty()) {
+    uint64_t offset = free_offsets.back();
+    free_offsets.pop_back();
+    return offset;
+  }
+  uint64_t offset = end_offset_;
+  end_offset_ += num_sectors * SECTOR_SIZE;
+  return offset;
+}
+
+}  // namespace bustub
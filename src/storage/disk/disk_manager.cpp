@@ -10,16 +10,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
 #include <cstring>
 #include <iostream>
-#include <mutex>  // NOLINT
+#include <iterator>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/util/crc32c.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -30,14 +39,24 @@ static char *buffer_used;
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool direct_io)
+    : db_fd_(-1),
+      num_writes_(0),
+      num_reads_(0),
+      direct_io_(direct_io),
+      file_name_(db_file),
+      num_flushes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  free_map_name_ = file_name_.substr(0, n) + ".fsm";
+  checksum_name_ = file_name_.substr(0, n) + ".crc";
+  double_write_name_ = file_name_.substr(0, n) + ".dwb";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -53,30 +72,116 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT | (direct_io_ ? O_DIRECT : 0), 0644);
+  if (db_fd_ == -1 && direct_io_ && errno == EINVAL) {
+    // the file system does not support O_DIRECT (e.g. tmpfs)
+    LOG_WARN("direct I/O is not supported for %s, using buffered I/O", db_file.c_str());
+    direct_io_ = false;
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (db_fd_ == -1 && (errno == EACCES || errno == EROFS)) {
+    // read-only file or file system
+    db_fd_ = open(db_file.c_str(), O_RDONLY | (direct_io_ ? O_DIRECT : 0));
+  }
+  // directory does not exist
+  if (db_fd_ == -1) {
+    throw Exception("can't open db file");
   }
   buffer_used = nullptr;
+
+  // A new db file has no free pages and no checksums; a free page map or checksum file found next to it belongs to a
+  // deleted file of the same name.
+  struct stat stat_buf;
+  bool is_new_file = fstat(db_fd_, &stat_buf) != 0 || stat_buf.st_size == 0;
+  if (!is_new_file) {
+    page_high_water_ = static_cast<page_id_t>((stat_buf.st_size + PAGE_SIZE - 1) / PAGE_SIZE);
+    std::ifstream free_map_in(free_map_name_, std::ios::binary);
+    free_map_.assign(std::istreambuf_iterator<char>(free_map_in), std::istreambuf_iterator<char>());
+    for (size_t byte = 0; byte < free_map_.size(); byte++) {
+      for (int bit = 0; bit < 8; bit++) {
+        if ((free_map_[byte] & (1U << bit)) != 0) {
+          free_pages_[0].insert(static_cast<page_id_t>(byte * 8 + bit));
+          SetFreeBit(static_cast<page_id_t>(byte * 8 + bit), true);
+          RecordAllocatedPage(static_cast<page_id_t>(byte * 8 + bit));
+        }
+      }
+    }
+    std::ifstream checksum_in(checksum_name_, std::ios::binary | std::ios::ate);
+    if (checksum_in.is_open()) {
+      std::vector<uint32_t> checksums(static_cast<size_t>(checksum_in.tellg()) / sizeof(uint32_t));
+      checksum_in.seekg(0);
+      checksum_in.read(reinterpret_cast<char *>(checksums.data()),
+                       static_cast<std::streamsize>(checksums.size() * sizeof(uint32_t)));
+      RecordChecksums(0, checksums.data(), checksums.size());
+    }
+  } else {
+    remove(free_map_name_.c_str());
+    remove(checksum_name_.c_str());
+    remove(double_write_name_.c_str());
+  }
+  checksum_fd_ = open(checksum_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (checksum_fd_ == -1) {
+    LOG_DEBUG("can't open checksum file");
+  }
+  if (!is_new_file) {
+    RecoverFromDoubleWriteBuffer();
+  }
+}
+
+DiskManager::~DiskManager() {
+  if (db_fd_ != -1) {
+    PersistChecksums();
+  }
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_size_);
+  }
+  if (db_fd_ != -1) {
+    close(db_fd_);
+  }
+  if (free_map_fd_ != -1) {
+    close(free_map_fd_);
+  }
+  if (checksum_fd_ != -1) {
+    close(checksum_fd_);
+  }
+  if (double_write_fd_ != -1) {
+    close(double_write_fd_);
+  }
+  for (auto &chunk : free_bits_) {
+    delete[] chunk.load();
+  }
+  for (auto &chunk : checksums_) {
+    delete[] chunk.load();
+  }
 }
 
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+  if (db_fd_ != -1) {
+    PersistChecksums();
+  }
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_size_);
+    mapped_data_ = nullptr;
+    mapped_size_ = 0;
+  }
+  if (db_fd_ != -1) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
+  if (free_map_fd_ != -1) {
+    close(free_map_fd_);
+    free_map_fd_ = -1;
+  }
+  int checksum_fd = checksum_fd_.exchange(-1);
+  if (checksum_fd != -1) {
+    close(checksum_fd);
+  }
+  if (double_write_fd_ != -1) {
+    close(double_write_fd_);
+    double_write_fd_ = -1;
   }
   log_io_.close();
 }
@@ -85,48 +190,705 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
-  num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  if (double_write_enabled_) {
+    // A single page, e.g. an evicted or flushed one, is torn as easily as a batch, so it goes the same way.
+    std::vector<DiskRequest> requests{{true, page_id, const_cast<char *>(page_data)}};
+    DiskManager::SubmitRequests(&requests);
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  std::shared_lock resize_latch(resize_latch_);
+  WritePages(page_id, &page_data, 1, false);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
+auto DiskManager::ReadPage(page_id_t page_id, char *page_data) -> bool { return ReadPages(page_id, &page_data, 1); }
+
+/**
+ * Sort the batch by page id and hand every run of same-kind requests for consecutive pages to a single vectored call.
+ * With the double-write buffer on, the writes go to the double-write buffer first.
+ */
+void DiskManager::SubmitRequests(std::vector<DiskRequest> *requests) {
+  std::shared_lock resize_latch(resize_latch_);
+  std::sort(requests->begin(), requests->end(),
+            [](const DiskRequest &a, const DiskRequest &b) { return a.page_id_ < b.page_id_; });
+  std::unique_lock<std::mutex> double_write_latch;
+  if (double_write_enabled_ &&
+      std::any_of(requests->begin(), requests->end(), [](const DiskRequest &request) { return request.is_write_; })) {
+    double_write_latch = std::unique_lock(double_write_latch_);
+    WriteDoubleWriteBuffer(*requests);
+  }
+  std::vector<char *> buffers;
+  size_t begin = 0;
+  while (begin < requests->size()) {
+    const DiskRequest &first = (*requests)[begin];
+    buffers.clear();
+    size_t end = begin;
+    while (end < requests->size() && buffers.size() < IOV_MAX && (*requests)[end].is_write_ == first.is_write_ &&
+           (*requests)[end].page_id_ == first.page_id_ + static_cast<page_id_t>(end - begin)) {
+      buffers.push_back((*requests)[end].data_);
+      end++;
+    }
+    if (first.is_write_) {
+      WritePages(first.page_id_, buffers.data(), buffers.size(), double_write_latch.owns_lock());
+    } else {
+      ReadPages(first.page_id_, buffers.data(), buffers.size());
+    }
+    begin = end;
+  }
+  if (double_write_latch.owns_lock()) {
+    FinishDoubleWrite();
+  }
+}
+
+/**
+ * Write a run of consecutive pages, retrying until every byte is written, and record their checksums once the pages
+ * are written. Outside the double-write buffer, the entries in the checksum file are cleared before the pages are
+ * written, so that a crash in between does not leave a page behind a checksum it does not match.
+ */
+void DiskManager::WritePages(page_id_t page_id, const char *const *buffers, size_t num_pages, bool double_written) {
+  if (!CanUseBuffers(buffers, num_pages)) {
+    alignas(DIRECT_IO_ALIGNMENT) static thread_local char bounce_buffer[PAGE_SIZE];
+    const char *bounce_buffer_ptr = bounce_buffer;
+    for (size_t i = 0; i < num_pages; i++) {
+      memcpy(bounce_buffer, buffers[i], PAGE_SIZE);
+      WritePages(page_id + static_cast<page_id_t>(i), &bounce_buffer_ptr, 1, double_written);
+    }
+    return;
+  }
+  std::vector<iovec> iov(num_pages);
+  std::vector<uint32_t> checksums(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    iov[i] = {const_cast<char *>(buffers[i]), PAGE_SIZE};
+    checksums[i] = ChecksumsEnabled() ? ComputeChecksum(buffers[i]) : 0;
+  }
+  if (!double_written) {
+    BeginChecksumUpdate(page_id, num_pages);
+  }
+  num_writes_ += static_cast<int>(num_pages);
+  RecordAllocatedPage(page_id + static_cast<page_id_t>(num_pages) - 1);
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+  size_t next_iov = 0;
+  while (next_iov < num_pages) {
+    ssize_t written = pwritev(db_fd_, &iov[next_iov], static_cast<int>(num_pages - next_iov), offset);
+    // check for I/O error
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_DEBUG("I/O error while writing");
+      break;
+    }
+    offset += written;
+    // skip the buffers written in full and resume in the middle of a partially written one
+    while (next_iov < num_pages && static_cast<size_t>(written) >= iov[next_iov].iov_len) {
+      written -= static_cast<ssize_t>(iov[next_iov].iov_len);
+      next_iov++;
+    }
+    if (next_iov < num_pages) {
+      iov[next_iov].iov_base = static_cast<char *>(iov[next_iov].iov_base) + written;
+      iov[next_iov].iov_len -= written;
+    }
+  }
+  RecordChecksums(page_id, checksums.data(), num_pages);
+  if (double_written) {
+    // synced by FinishDoubleWrite, after the pages
+    WriteChecksumEntries(page_id, checksums.data(), num_pages);
+  }
+}
+
+/**
+ * Read a run of consecutive pages and verify their checksums. Whatever lies past the end of the file, or could not be
+ * read, reads as zeros, and fails verification if the page has a checksum.
+ */
+auto DiskManager::ReadPages(page_id_t page_id, char *const *buffers, size_t num_pages) -> bool {
+  if (!CanUseBuffers(buffers, num_pages)) {
+    alignas(DIRECT_IO_ALIGNMENT) static thread_local char bounce_buffer[PAGE_SIZE];
+    char *bounce_buffer_ptr = bounce_buffer;
+    bool verified = true;
+    for (size_t i = 0; i < num_pages; i++) {
+      verified = ReadPages(page_id + static_cast<page_id_t>(i), &bounce_buffer_ptr, 1) && verified;
+      memcpy(buffers[i], bounce_buffer, PAGE_SIZE);
+    }
+    return verified;
+  }
+  std::vector<iovec> iov(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    iov[i] = {buffers[i], PAGE_SIZE};
+  }
+  num_reads_ += static_cast<int>(num_pages);
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+  size_t next_iov = 0;
+  while (next_iov < num_pages) {
+    ssize_t read_count = preadv(db_fd_, &iov[next_iov], static_cast<int>(num_pages - next_iov), offset);
+    if (read_count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
       LOG_DEBUG("I/O error while reading");
+    } else if (read_count == 0) {
+      // if file ends before reading all the pages
+      LOG_DEBUG("Read less than a page");
+    }
+    if (read_count <= 0) {
+      for (; next_iov < num_pages; next_iov++) {
+        memset(iov[next_iov].iov_base, 0, iov[next_iov].iov_len);
+      }
+      break;
+    }
+    offset += read_count;
+    while (next_iov < num_pages && static_cast<size_t>(read_count) >= iov[next_iov].iov_len) {
+      read_count -= static_cast<ssize_t>(iov[next_iov].iov_len);
+      next_iov++;
+    }
+    if (next_iov < num_pages) {
+      iov[next_iov].iov_base = static_cast<char *>(iov[next_iov].iov_base) + read_count;
+      iov[next_iov].iov_len -= read_count;
+    }
+  }
+  if (!ChecksumsEnabled()) {
+    return true;
+  }
+  bool verified = true;
+  for (size_t i = 0; i < num_pages; i++) {
+    auto cur_page_id = page_id + static_cast<page_id_t>(i);
+    uint32_t checksum = GetStoredChecksum(cur_page_id);
+    if (checksum == 0 || ComputeChecksum(buffers[i]) == checksum) {
+      continue;
+    }
+    if (HandleChecksumMismatch(cur_page_id, buffers[i])) {
+      WritePages(cur_page_id, &buffers[i], 1, false);
+    } else {
+      verified = false;
+    }
+  }
+  return verified;
+}
+
+/**
+ * Direct I/O needs every buffer aligned; buffered I/O takes anything
+ */
+auto DiskManager::CanUseBuffers(const char *const *buffers, size_t num_pages) const -> bool {
+  if (!direct_io_) {
+    return true;
+  }
+  return std::all_of(buffers, buffers + num_pages, [](const char *buffer) {
+    return reinterpret_cast<uintptr_t>(buffer) % DIRECT_IO_ALIGNMENT == 0;
+  });
+}
+
+/**
+ * Map the db file read-only, once, and hand out the same mapping on every call
+ */
+auto DiskManager::MapReadOnly(size_t *num_pages) -> const char * {
+  std::scoped_lock map_latch(map_latch_);
+  if (mapped_data_ == nullptr) {
+    struct stat stat_buf;
+    if (fstat(db_fd_, &stat_buf) != 0 || stat_buf.st_size < static_cast<off_t>(PAGE_SIZE)) {
+      *num_pages = 0;
+      return nullptr;
+    }
+    size_t size = stat_buf.st_size / PAGE_SIZE * PAGE_SIZE;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, db_fd_, 0);
+    if (data == MAP_FAILED) {
+      LOG_DEBUG("can't map db file");
+      *num_pages = 0;
+      return nullptr;
+    }
+    mapped_data_ = static_cast<char *>(data);
+    mapped_size_ = size;
+  }
+  *num_pages = mapped_size_ / PAGE_SIZE;
+  return mapped_data_;
+}
+
+/**
+ * Remember the page as free, in memory and in the free page map file
+ */
+auto DiskManager::DeallocatePage(page_id_t page_id) -> bool {
+  if (!IsAllocatedPage(page_id)) {
+    return false;
+  }
+  {
+    std::scoped_lock latch(free_latch_);
+    if (free_pages_[page_id % free_num_instances_].insert(page_id).second) {
+      WriteFreeMapBit(page_id, true);
+    }
+  }
+  // The page may become a hole, which reads as zeros.
+  const uint32_t no_checksum = 0;
+  BeginChecksumUpdate(page_id, 1);
+  RecordChecksums(page_id, &no_checksum, 1);
+  return true;
+}
+
+void DiskManager::RecordAllocatedPage(page_id_t page_id) {
+  page_id_t high_water = page_high_water_;
+  while (high_water <= page_id && !page_high_water_.compare_exchange_weak(high_water, page_id + 1)) {
+  }
+}
+
+/**
+ * Hand out the lowest free page of the instance. The free pages are split by instance on the first call.
+ */
+auto DiskManager::AllocateFreePage(uint32_t num_instances, uint32_t instance_index) -> page_id_t {
+  std::scoped_lock latch(free_latch_);
+  if (num_instances != free_num_instances_) {
+    std::vector<std::set<page_id_t>> free_pages(num_instances);
+    for (const auto &partition : free_pages_) {
+      for (page_id_t page_id : partition) {
+        free_pages[page_id % num_instances].insert(page_id);
+      }
+    }
+    free_pages_ = std::move(free_pages);
+    free_num_instances_ = num_instances;
+  }
+  auto &partition = free_pages_[instance_index];
+  if (partition.empty()) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t page_id = *partition.begin();
+  partition.erase(partition.begin());
+  WriteFreeMapBit(page_id, false);
+  return page_id;
+}
+
+auto DiskManager::IsPageFree(page_id_t page_id) const -> bool {
+  if (page_id < 0) {
+    return false;
+  }
+  const std::atomic<uint64_t> *chunk = free_bits_[page_id / FREE_BITS_PER_CHUNK].load(std::memory_order_acquire);
+  if (chunk == nullptr) {
+    return false;
+  }
+  size_t bit = page_id % FREE_BITS_PER_CHUNK;
+  return ((chunk[bit / 64].load(std::memory_order_acquire) >> (bit % 64)) & 1) != 0;
+}
+
+auto DiskManager::GetNumFreePages() -> size_t {
+  std::scoped_lock latch(free_latch_);
+  size_t num_free_pages = 0;
+  for (const auto &partition : free_pages_) {
+    num_free_pages += partition.size();
+  }
+  return num_free_pages;
+}
+
+/**
+ * Truncate the file after the last page in use and punch a hole for every run of free pages before it
+ */
+auto DiskManager::CompactFile() -> uint64_t {
+  std::unique_lock resize_latch(resize_latch_);
+  std::scoped_lock latch(free_latch_, map_latch_);
+  uint64_t allocated_bytes = GetAllocatedBytes();
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0) {
+    return 0;
+  }
+  std::set<page_id_t> free_pages;
+  for (const auto &partition : free_pages_) {
+    free_pages.insert(partition.begin(), partition.end());
+  }
+
+  auto end = static_cast<page_id_t>((stat_buf.st_size + PAGE_SIZE - 1) / PAGE_SIZE);
+  // Pages past the end of a mapping would fault when touched, so a mapped file keeps its size.
+  if (mapped_data_ == nullptr) {
+    while (end > 0 && free_pages.count(end - 1) > 0) {
+      end--;
+    }
+    auto size = static_cast<off_t>(end) * PAGE_SIZE;
+    if (size < stat_buf.st_size && ftruncate(db_fd_, size) != 0) {
+      LOG_DEBUG("can't truncate db file");
+    }
+  }
+  auto iter = free_pages.begin();
+  while (iter != free_pages.end() && *iter < end) {
+    page_id_t first = *iter;
+    page_id_t last = first;
+    while (++iter != free_pages.end() && *iter == last + 1 && *iter < end) {
+      last++;
+    }
+    if (fallocate(db_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(first) * PAGE_SIZE,
+                  static_cast<off_t>(last - first + 1) * PAGE_SIZE) != 0) {
+      LOG_DEBUG("can't punch a hole into db file");
+    }
+  }
+  uint64_t compacted_bytes = GetAllocatedBytes();
+  return allocated_bytes > compacted_bytes ? allocated_bytes - compacted_bytes : 0;
+}
+
+auto DiskManager::GetAllocatedBytes() -> uint64_t {
+  struct stat stat_buf;
+  return fstat(db_fd_, &stat_buf) == 0 ? static_cast<uint64_t>(stat_buf.st_blocks) * 512 : 0;
+}
+
+/**
+ * Update one bit of the bitmap and write back the byte holding it
+ */
+void DiskManager::WriteFreeMapBit(page_id_t page_id, bool is_free) {
+  SetFreeBit(page_id, is_free);
+  if (free_map_fd_ == -1) {
+    free_map_fd_ = open(free_map_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (free_map_fd_ == -1) {
+      LOG_DEBUG("can't open free page map file");
       return;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+  }
+  size_t byte = page_id / 8;
+  if (byte >= free_map_.size()) {
+    free_map_.resize(byte + 1);
+  }
+  auto mask = static_cast<uint8_t>(1U << (page_id % 8));
+  free_map_[byte] = is_free ? (free_map_[byte] | mask) : (free_map_[byte] & ~mask);
+  if (pwrite(free_map_fd_, &free_map_[byte], 1, static_cast<off_t>(byte)) != 1) {
+    LOG_DEBUG("I/O error while writing free page map");
+  }
+}
+
+void DiskManager::SetFreeBit(page_id_t page_id, bool is_free) {
+  std::atomic<uint64_t> *chunk = free_bits_[page_id / FREE_BITS_PER_CHUNK].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    if (!is_free) {
+      return;
     }
+    chunk = new std::atomic<uint64_t>[FREE_BITS_PER_CHUNK / 64]();
+    free_bits_[page_id / FREE_BITS_PER_CHUNK].store(chunk, std::memory_order_release);
   }
+  size_t bit = page_id % FREE_BITS_PER_CHUNK;
+  uint64_t mask = uint64_t{1} << (bit % 64);
+  if (is_free) {
+    chunk[bit / 64].fetch_or(mask, std::memory_order_release);
+  } else {
+    chunk[bit / 64].fetch_and(~mask, std::memory_order_release);
+  }
+}
+
+/** Write all of a buffer at an offset of a file, resuming after short writes. @return true on success */
+static auto WriteFully(int fd, const char *data, size_t size, off_t offset) -> bool {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+auto DiskManager::GetChecksumSlot(page_id_t page_id, bool create) -> std::atomic<uint64_t> * {
+  assert(page_id >= 0);
+  std::atomic<std::atomic<uint64_t> *> &chunk_ptr = checksums_[page_id / CHECKSUMS_PER_CHUNK];
+  std::atomic<uint64_t> *chunk = chunk_ptr.load(std::memory_order_acquire);
+  if (chunk == nullptr) {
+    if (!create) {
+      return nullptr;
+    }
+    auto *new_chunk = new std::atomic<uint64_t>[CHECKSUMS_PER_CHUNK]();
+    if (chunk_ptr.compare_exchange_strong(chunk, new_chunk, std::memory_order_acq_rel)) {
+      chunk = new_chunk;
+    } else {
+      delete[] new_chunk;
+    }
+  }
+  return &chunk[page_id % CHECKSUMS_PER_CHUNK];
+}
+
+/**
+ * Pages that are pending already have a cleared entry. Of the others, only those with a checksum in the file need
+ * the clear to be durable; the pending flags are set once it is, so that a concurrent write of the same page cannot
+ * get ahead of it.
+ */
+void DiskManager::BeginChecksumUpdate(page_id_t page_id, size_t num_pages) {
+  auto is_pending = [this](page_id_t cur_page_id) {
+    std::atomic<uint64_t> *slot = GetChecksumSlot(cur_page_id, false);
+    return slot != nullptr && (slot->load(std::memory_order_acquire) & CHECKSUM_PENDING) != 0;
+  };
+  bool all_pending = true;
+  for (size_t i = 0; i < num_pages && all_pending; i++) {
+    all_pending = is_pending(page_id + static_cast<page_id_t>(i));
+  }
+  if (all_pending) {
+    return;
+  }
+
+  std::scoped_lock latch(checksum_latch_);
+  std::vector<std::atomic<uint64_t> *> slots;
+  bool has_checksum = false;
+  for (size_t i = 0; i < num_pages; i++) {
+    std::atomic<uint64_t> *slot = GetChecksumSlot(page_id + static_cast<page_id_t>(i), true);
+    uint64_t value = slot->load(std::memory_order_acquire);
+    if ((value & CHECKSUM_PENDING) == 0) {
+      has_checksum = has_checksum || static_cast<uint32_t>(value) != 0;
+      slots.push_back(slot);
+      pending_checksum_pages_.push_back(page_id + static_cast<page_id_t>(i));
+    }
+  }
+  int fd = checksum_fd_;
+  if (has_checksum && fd != -1) {
+    // Clearing the entries of pages that are pending or have no checksum changes nothing, so the run is cleared whole.
+    std::vector<uint32_t> no_checksums(num_pages, 0);
+    WriteChecksumEntries(page_id, no_checksums.data(), num_pages);
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing checksums");
+    }
+  }
+  for (std::atomic<uint64_t> *slot : slots) {
+    slot->fetch_or(CHECKSUM_PENDING, std::memory_order_release);
+  }
+}
+
+void DiskManager::RecordChecksums(page_id_t page_id, const uint32_t *checksums, size_t num_pages) {
+  for (size_t i = 0; i < num_pages; i++) {
+    // A page without a chunk has no checksum, so clearing it needs none.
+    std::atomic<uint64_t> *slot = GetChecksumSlot(page_id + static_cast<page_id_t>(i), checksums[i] != 0);
+    if (slot == nullptr) {
+      continue;
+    }
+    uint64_t value = slot->load(std::memory_order_relaxed);
+    while (!slot->compare_exchange_weak(value, (value & CHECKSUM_PENDING) | checksums[i], std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+}
+
+void DiskManager::WriteChecksumEntries(page_id_t page_id, const uint32_t *checksums, size_t num_pages) {
+  int fd = checksum_fd_;
+  if (fd == -1) {
+    return;
+  }
+  if (!WriteFully(fd, reinterpret_cast<const char *>(checksums), num_pages * sizeof(uint32_t),
+                  static_cast<off_t>(page_id) * sizeof(uint32_t))) {
+    LOG_DEBUG("I/O error while writing checksums");
+  }
+}
+
+auto DiskManager::GetStoredChecksum(page_id_t page_id) -> uint32_t {
+  std::atomic<uint64_t> *slot = GetChecksumSlot(page_id, false);
+  return slot == nullptr ? 0 : static_cast<uint32_t>(slot->load(std::memory_order_acquire));
+}
+
+/**
+ * The pages go first, so that no checksum reaches the file ahead of its page. Runs of consecutive pending pages are
+ * written with one call each.
+ */
+void DiskManager::PersistChecksums() {
+  std::scoped_lock latch(checksum_latch_);
+  if (pending_checksum_pages_.empty()) {
+    return;
+  }
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing db file");
+  }
+  std::sort(pending_checksum_pages_.begin(), pending_checksum_pages_.end());
+  std::vector<uint32_t> run;
+  for (size_t i = 0; i < pending_checksum_pages_.size(); i++) {
+    page_id_t cur_page_id = pending_checksum_pages_[i];
+    uint64_t value = GetChecksumSlot(cur_page_id, false)->fetch_and(~CHECKSUM_PENDING, std::memory_order_acq_rel);
+    run.push_back(static_cast<uint32_t>(value));
+    if (i + 1 == pending_checksum_pages_.size() || pending_checksum_pages_[i + 1] != cur_page_id + 1) {
+      WriteChecksumEntries(cur_page_id + 1 - static_cast<page_id_t>(run.size()), run.data(), run.size());
+      run.clear();
+    }
+  }
+  pending_checksum_pages_.clear();
+  int fd = checksum_fd_;
+  if (fd != -1 && fdatasync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing checksums");
+  }
+}
+
+/** Read all of a buffer from an offset of a file. @return false if the file ends first or cannot be read */
+static auto ReadFully(int fd, char *data, size_t size, off_t offset) -> bool {
+  while (size > 0) {
+    ssize_t read_count = pread(fd, data, size, offset);
+    if (read_count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read_count <= 0) {
+      return false;
+    }
+    data += read_count;
+    size -= read_count;
+    offset += read_count;
+  }
+  return true;
+}
+
+/** @return the checksum of a double-write buffer header: the CRC32C of the page count and the entries */
+static auto DoubleWriteChecksum(uint32_t num_pages, const char *entries, size_t entries_size) -> uint32_t {
+  return Crc32c::Extend(Crc32c::Value(reinterpret_cast<const char *>(&num_pages), sizeof(num_pages)), entries,
+                        entries_size);
+}
+
+/**
+ * Lay out the header, the entries and the pages in one buffer and write it with a single sequential write. The pages
+ * start at a multiple of PAGE_SIZE.
+ */
+void DiskManager::WriteDoubleWriteBuffer(const std::vector<DiskRequest> &requests) {
+  if (double_write_fd_ == -1) {
+    double_write_fd_ = open(double_write_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (double_write_fd_ == -1) {
+      LOG_DEBUG("can't open double-write buffer file");
+      return;
+    }
+  }
+  std::vector<DoubleWriteEntry> entries;
+  for (const DiskRequest &request : requests) {
+    if (request.is_write_) {
+      entries.push_back({request.page_id_, ComputeChecksum(request.data_)});
+    }
+  }
+  size_t entries_size = entries.size() * sizeof(DoubleWriteEntry);
+  size_t header_size = (sizeof(DoubleWriteHeader) + entries_size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+  std::vector<char> buffer(header_size + entries.size() * PAGE_SIZE);
+  auto num_pages = static_cast<uint32_t>(entries.size());
+  DoubleWriteHeader header{DOUBLE_WRITE_MAGIC, num_pages,
+                           DoubleWriteChecksum(num_pages, reinterpret_cast<const char *>(entries.data()), entries_size),
+                           0};
+  memcpy(buffer.data(), &header, sizeof(header));
+  memcpy(buffer.data() + sizeof(header), entries.data(), entries_size);
+  char *page_data = buffer.data() + header_size;
+  for (const DiskRequest &request : requests) {
+    if (request.is_write_) {
+      memcpy(page_data, request.data_, PAGE_SIZE);
+      page_data += PAGE_SIZE;
+    }
+  }
+  if (!WriteFully(double_write_fd_, buffer.data(), buffer.size(), 0) || fdatasync(double_write_fd_) != 0) {
+    LOG_DEBUG("I/O error while writing double-write buffer");
+  }
+}
+
+/**
+ * Once the pages are durable in place, the copies are no longer needed. The empty header is not synced: if it is
+ * lost, the next start finds the copies again, and only uses them for pages that fail verification.
+ */
+void DiskManager::FinishDoubleWrite() {
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing db file");
+  }
+  int checksum_fd = checksum_fd_;
+  if (checksum_fd != -1 && fdatasync(checksum_fd) != 0) {
+    LOG_DEBUG("I/O error while syncing checksums");
+  }
+  DoubleWriteHeader header{DOUBLE_WRITE_MAGIC, 0, DoubleWriteChecksum(0, nullptr, 0), 0};
+  if (double_write_fd_ != -1 &&
+      !WriteFully(double_write_fd_, reinterpret_cast<const char *>(&header), sizeof(header), 0)) {
+    LOG_DEBUG("I/O error while writing double-write buffer");
+  }
+}
+
+/**
+ * A page of the last batch is restored if its copy is intact and the page matches neither the copy nor its stored
+ * checksum, i.e. it was torn. An intact page is kept even if it is older than the copy: the batch did not complete,
+ * so either version is valid. The buffer is emptied afterwards, so that later writes are never undone by its copies.
+ */
+void DiskManager::RecoverFromDoubleWriteBuffer() {
+  int fd = open(double_write_name_.c_str(), O_RDWR);
+  if (fd == -1) {
+    return;
+  }
+  DoubleWriteHeader header;
+  std::vector<DoubleWriteEntry> entries;
+  bool is_valid = ReadFully(fd, reinterpret_cast<char *>(&header), sizeof(header), 0) &&
+                  header.magic_ == DOUBLE_WRITE_MAGIC && header.num_pages_ <= (1U << 24);
+  if (is_valid) {
+    entries.resize(header.num_pages_);
+    size_t entries_size = entries.size() * sizeof(DoubleWriteEntry);
+    is_valid = ReadFully(fd, reinterpret_cast<char *>(entries.data()), entries_size, sizeof(header)) &&
+               header.checksum_ ==
+                   DoubleWriteChecksum(header.num_pages_, reinterpret_cast<const char *>(entries.data()), entries_size);
+  }
+  if (!is_valid) {
+    // torn while the batch was written to it, before any page was written in place
+    close(fd);
+    return;
+  }
+
+  size_t header_size =
+      (sizeof(DoubleWriteHeader) + entries.size() * sizeof(DoubleWriteEntry) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+  alignas(DIRECT_IO_ALIGNMENT) static thread_local char copy[PAGE_SIZE];
+  alignas(DIRECT_IO_ALIGNMENT) static thread_local char in_place[PAGE_SIZE];
+  const char *copy_ptr = copy;
+  for (size_t i = 0; i < entries.size(); i++) {
+    const DoubleWriteEntry &entry = entries[i];
+    if (!ReadFully(fd, copy, PAGE_SIZE, static_cast<off_t>(header_size + i * PAGE_SIZE)) ||
+        ComputeChecksum(copy) != entry.checksum_) {
+      continue;
+    }
+    if (!ReadFully(db_fd_, in_place, PAGE_SIZE, static_cast<off_t>(entry.page_id_) * PAGE_SIZE)) {
+      memset(in_place, 0, PAGE_SIZE);
+    }
+    uint32_t checksum = ComputeChecksum(in_place);
+    uint32_t stored_checksum = GetStoredChecksum(entry.page_id_);
+    if (checksum == entry.checksum_) {
+      // written in full, but maybe not its checksum
+      if (stored_checksum != checksum) {
+        RecordChecksums(entry.page_id_, &checksum, 1);
+        WriteChecksumEntries(entry.page_id_, &checksum, 1);
+      }
+    } else if (checksum != stored_checksum) {
+      LOG_INFO("restoring torn page %d of %s from the double-write buffer", entry.page_id_, file_name_.c_str());
+      WritePages(entry.page_id_, &copy_ptr, 1, true);
+      num_double_write_repairs_++;
+    }
+  }
+  if (num_double_write_repairs_ > 0 && fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing db file");
+  }
+  if (checksum_fd_ != -1 && fdatasync(checksum_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing checksums");
+  }
+  header = {DOUBLE_WRITE_MAGIC, 0, DoubleWriteChecksum(0, nullptr, 0), 0};
+  if (!WriteFully(fd, reinterpret_cast<const char *>(&header), sizeof(header), 0) || fdatasync(fd) != 0) {
+    LOG_DEBUG("I/O error while writing double-write buffer");
+  }
+  close(fd);
+}
+
+auto DiskManager::ComputeChecksum(const char *page_data) -> uint32_t {
+  uint32_t checksum = Crc32c::Value(page_data, PAGE_SIZE);
+  return checksum == 0 ? 1 : checksum;
+}
+
+/**
+ * Count the failure, then try the repair handler on a zeroed page. Unrepaired pages stay zeroed and are remembered.
+ */
+auto DiskManager::HandleChecksumMismatch(page_id_t page_id, char *page_data) -> bool {
+  LOG_WARN("checksum mismatch on page %d of %s", page_id, file_name_.c_str());
+  num_checksum_failures_++;
+  memset(page_data, 0, PAGE_SIZE);
+  page_repair_fn handler;
+  {
+    std::scoped_lock latch(repair_latch_);
+    handler = repair_handler_;
+  }
+  bool repaired = handler && handler(page_id, page_data);
+  std::scoped_lock latch(repair_latch_);
+  if (repaired) {
+    LOG_INFO("repaired page %d of %s", page_id, file_name_.c_str());
+    corrupt_pages_.erase(page_id);
+  } else {
+    memset(page_data, 0, PAGE_SIZE);
+    corrupt_pages_.insert(page_id);
+  }
+  return repaired;
+}
+
+void DiskManager::SetPageRepairHandler(page_repair_fn handler) {
+  std::scoped_lock latch(repair_latch_);
+  repair_handler_ = std::move(handler);
+}
+
+auto DiskManager::GetCorruptPages() -> std::vector<page_id_t> {
+  std::scoped_lock latch(repair_latch_);
+  return {corrupt_pages_.begin(), corrupt_pages_.end()};
 }
 
 /**
@@ -134,6 +896,7 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  * Only return when sync is done, and only perform sequence write
  */
 void DiskManager::WriteLog(char *log_data, int size) {
+  std::scoped_lock log_latch(log_latch_);
   // enforce swap log buffer
   assert(log_data != buffer_used);
   buffer_used = log_data;
@@ -169,6 +932,7 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
+  std::scoped_lock log_latch(log_latch_);
   if (offset >= GetFileSize(log_name_)) {
     // LOG_DEBUG("end of log file");
     // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
@@ -200,6 +964,11 @@ auto DiskManager::GetNumFlushes() const -> int { return num_flushes_; }
  */
 auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
 
+/**
+ * Returns number of page reads made so far
+ */
+auto DiskManager::GetNumReads() const -> int { return num_reads_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extendible_hash_table_header_page.cpp
+//
+// Identification: src/storage/page/extendible_hash_table_header_page.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/extendible_hash_table_header_page.h"
+
+#include <cassert>
+
+namespace bustub {
+
+void ExtendibleHashTableHeaderPage::Init(page_id_t page_id, uint32_t depth) {
+  assert(depth <= HEADER_MAX_DEPTH);
+  page_id_ = page_id;
+  depth_ = depth;
+  for (uint32_t i = 0; i < Size(); i++) {
+    directory_page_ids_[i] = INVALID_PAGE_ID;
+  }
+}
+
+auto ExtendibleHashTableHeaderPage::GetPageId() const -> page_id_t { return page_id_; }
+
+auto ExtendibleHashTableHeaderPage::GetLSN() const -> lsn_t { return lsn_; }
+
+void ExtendibleHashTableHeaderPage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+auto ExtendibleHashTableHeaderPage::GetDepth() const -> uint32_t { return depth_; }
+
+auto ExtendibleHashTableHeaderPage::Size() const -> uint32_t { return 1 << depth_; }
+
+auto ExtendibleHashTableHeaderPage::HashToDirectoryIndex(uint32_t hash) const -> uint32_t {
+  // A shift by 32 is undefined, hence the special case of a single directory.
+  return depth_ == 0 ? 0 : hash >> (32 - depth_);
+}
+
+auto ExtendibleHashTableHeaderPage::GetDirectoryPageId(uint32_t directory_idx) const -> page_id_t {
+  return directory_page_ids_[directory_idx];
+}
+
+void ExtendibleHashTableHeaderPage::SetDirectoryPageId(uint32_t directory_idx, page_id_t directory_page_id) {
+  directory_page_ids_[directory_idx] = directory_page_id;
+}
+
+}  // namespace bustub
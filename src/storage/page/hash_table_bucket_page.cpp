@@ -12,17 +12,168 @@
 
 #include "storage/page/hash_table_bucket_page.h"
 #include "common/logger.h"
+#include "common/util/crc32c.h"
 #include "common/util/hash_util.h"
 #include "storage/index/generic_key.h"
 #include "storage/index/hash_comparator.h"
 #include "storage/table/tmp_tuple.h"
+#include<cstring>
 #include<vector>
 #include<iostream>
 
+#if BUSTUB_HASH_FINGERPRINTS && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 namespace bustub {
 
+#if BUSTUB_HASH_FINGERPRINTS
+
+static_assert(BUCKET_GROUP_SIZE == 32, "a group of fingerprints is matched into a 32-bit mask");
+
+#if defined(__x86_64__)
+
+/** Compare 32 fingerprints with one AVX2 instruction. */
+__attribute__((target("avx2"))) static auto MatchFingerprintsAvx2(const uint8_t *fingerprints, uint8_t fingerprint)
+    -> uint32_t {
+  __m256i group = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(fingerprints));
+  __m256i equal = _mm256_cmpeq_epi8(group, _mm256_set1_epi8(static_cast<char>(fingerprint)));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+}
+
+/** Compare 32 fingerprints as two halves of 16 with SSE2, which every x86-64 CPU has. */
+static auto MatchFingerprintsSse2(const uint8_t *fingerprints, uint8_t fingerprint) -> uint32_t {
+  __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+  __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints));
+  __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints + 16));
+  auto low_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, needle)));
+  auto high_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, needle)));
+  return low_mask | high_mask << 16;
+}
+
+/** @return a bit for every one of the 32 fingerprints that equals the given one */
+static auto MatchFingerprints(const uint8_t *fingerprints, uint8_t fingerprint) -> uint32_t {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2 ? MatchFingerprintsAvx2(fingerprints, fingerprint) : MatchFingerprintsSse2(fingerprints, fingerprint);
+}
+
+#else
+
+static auto MatchFingerprints(const uint8_t *fingerprints, uint8_t fingerprint) -> uint32_t {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < BUCKET_GROUP_SIZE; i++) {
+    mask |= static_cast<uint32_t>(fingerprints[i] == fingerprint) << i;
+  }
+  return mask;
+}
+
+#endif
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::Fingerprint(const KeyType &key) -> uint8_t {
+  // The directory index comes from the low bits of a different hash, so all 8 bits still tell keys of a bucket apart.
+  return static_cast<uint8_t>(Crc32c::Value(reinterpret_cast<const char *>(&key), sizeof(KeyType)) >> 24);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GroupBits(const char *bitmap, uint32_t group) -> uint32_t {
+  // Bit i of byte j is slot 8 * j + i, so on a little-endian CPU the four bytes of a group load as its 32-bit mask.
+  uint32_t bits;
+  memcpy(&bits, bitmap + group * BUCKET_GROUP_SIZE / 8, sizeof(bits));
+  return bits;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::MatchGroup(uint32_t group, uint8_t fingerprint) const -> uint32_t {
+  uint32_t readable = GroupBits(readable_, group);
+  if (readable == 0) {
+    return 0;
+  }
+  return MatchFingerprints(fingerprints_ + group * BUCKET_GROUP_SIZE, fingerprint) & readable;
+}
+
+// Slots are occupied from the front, so the scans stop after the first group that is not fully occupied.
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const -> bool {
+  uint8_t fingerprint = Fingerprint(key);
+  bool found = false;
+  for (uint32_t group = 0; group < BUCKET_NUM_GROUPS; group++) {
+    for (uint32_t matches = MatchGroup(group, fingerprint); matches != 0; matches &= matches - 1) {
+      uint32_t bucket_idx = group * BUCKET_GROUP_SIZE + __builtin_ctz(matches);
+      if (cmp(KeyAt(bucket_idx), key) == 0) {
+        result->push_back(ValueAt(bucket_idx));
+        found = true;
+      }
+    }
+    if (GroupBits(occupied_, group) != UINT32_MAX) {
+      break;
+    }
+  }
+  return found;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) -> bool {
+  uint8_t fingerprint = Fingerprint(key);
+  uint32_t bucket_idx = BUCKET_ARRAY_SIZE;
+  for (uint32_t group = 0; group < BUCKET_NUM_GROUPS; group++) {
+    for (uint32_t matches = MatchGroup(group, fingerprint); matches != 0; matches &= matches - 1) {
+      uint32_t idx = group * BUCKET_GROUP_SIZE + __builtin_ctz(matches);
+      if (cmp(KeyAt(idx), key) == 0 && ValueAt(idx) == value) {
+        return false;
+      }
+    }
+    uint32_t occupied = GroupBits(occupied_, group);
+    if (occupied != UINT32_MAX) {
+      bucket_idx = group * BUCKET_GROUP_SIZE + __builtin_ctz(~occupied);
+      break;
+    }
+  }
+
+  if (bucket_idx >= BUCKET_ARRAY_SIZE) {
+    // Every slot has been used once; take the first tombstone.
+    for (uint32_t group = 0; group < BUCKET_NUM_GROUPS; group++) {
+      uint32_t readable = GroupBits(readable_, group);
+      if (readable != UINT32_MAX) {
+        bucket_idx = group * BUCKET_GROUP_SIZE + __builtin_ctz(~readable);
+        break;
+      }
+    }
+    if (bucket_idx >= BUCKET_ARRAY_SIZE) {
+      return false;
+    }
+  }
+
+  array_[bucket_idx] = std::make_pair(key, value);
+  fingerprints_[bucket_idx] = fingerprint;
+  SetOccupied(bucket_idx);
+  SetReadable(bucket_idx, true);
+  return true;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool {
+auto HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) -> bool {
+  uint8_t fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group < BUCKET_NUM_GROUPS; group++) {
+    for (uint32_t matches = MatchGroup(group, fingerprint); matches != 0; matches &= matches - 1) {
+      uint32_t bucket_idx = group * BUCKET_GROUP_SIZE + __builtin_ctz(matches);
+      if (cmp(KeyAt(bucket_idx), key) == 0 && ValueAt(bucket_idx) == value) {
+        SetReadable(bucket_idx, false);
+        return true;
+      }
+    }
+    if (GroupBits(occupied_, group) != UINT32_MAX) {
+      break;
+    }
+  }
+  return false;
+}
+
+#else
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const -> bool {
   for(size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
     if(!IsOccupied(bucket_idx))
       break;
@@ -75,6 +226,8 @@ auto HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator
   return false;
 }
 
+#endif
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const -> KeyType {
   return array_[bucket_idx].first;
@@ -124,22 +277,27 @@ void HASH_TABLE_BUCKET_TYPE::SetReadable(uint32_t bucket_idx, bool set_value) {
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_BUCKET_TYPE::IsFull() -> bool {
-  uint32_t byte_array_size = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
-  for(uint32_t i = 0; i < byte_array_size; i++ ) {
+auto HASH_TABLE_BUCKET_TYPE::IsFull() const -> bool {
+  // BUCKET_ARRAY_SIZE follows PAGE_SIZE and need not be a multiple of 8, so the last byte may be partly used.
+  constexpr uint32_t full_bytes = BUCKET_ARRAY_SIZE / 8;
+  for(uint32_t i = 0; i < full_bytes; i++ ) {
     if (readable_[i] != -1)
       return false;    
   }
-  return true;
+  constexpr uint32_t remaining_bits = BUCKET_ARRAY_SIZE % 8;
+  if (remaining_bits == 0)
+    return true;
+  constexpr char last_byte_mask = (1 << remaining_bits) - 1;
+  return (readable_[full_bytes] & last_byte_mask) == last_byte_mask;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_BUCKET_TYPE::NumReadable() -> uint32_t {
+auto HASH_TABLE_BUCKET_TYPE::NumReadable() const -> uint32_t {
   return 0;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_BUCKET_TYPE::IsEmpty() -> bool {
+auto HASH_TABLE_BUCKET_TYPE::IsEmpty() const -> bool {
   uint32_t bitmap_size = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
   for(uint32_t i = 0; i < bitmap_size; i++) {
     if(readable_[i])
@@ -150,6 +308,14 @@ auto HASH_TABLE_BUCKET_TYPE::IsEmpty() -> bool {
   return true;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::Prefetch() const {
+  const auto *end = reinterpret_cast<const char *>(array_);
+  for (const char *line = occupied_; line < end; line += 64) {
+    __builtin_prefetch(line);
+  }
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
   uint32_t size = 0;
@@ -172,6 +338,10 @@ void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
   LOG_INFO("Bucket Capacity: %lu, Size: %u, Taken: %u, Free: %u", BUCKET_ARRAY_SIZE, size, taken, free);
 }
 
+// The bucket array is sized from PAGE_SIZE; make sure the largest layout still fits in one page.
+static_assert(sizeof(HashTableBucketPage<int, int, IntComparator>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>) <= PAGE_SIZE);
+
 // DO NOT REMOVE ANYTHING BELOW THIS LINE
 template class HashTableBucketPage<int, int, IntComparator>;
 
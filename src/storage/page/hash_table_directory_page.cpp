@@ -24,28 +24,30 @@ auto HashTableDirectoryPage::GetLSN() const -> lsn_t { return lsn_; }
 
 void HashTableDirectoryPage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
-auto HashTableDirectoryPage::GetGlobalDepth() -> uint32_t { return global_depth_; }
+auto HashTableDirectoryPage::GetGlobalDepth() const -> uint32_t { return global_depth_; }
 
-auto HashTableDirectoryPage::GetGlobalDepthMask() -> uint32_t { return (1<<global_depth_)-1; }
+auto HashTableDirectoryPage::GetGlobalDepthMask() const -> uint32_t { return (1<<global_depth_)-1; }
 
 void HashTableDirectoryPage::IncrGlobalDepth() { global_depth_++; }
 
 void HashTableDirectoryPage::DecrGlobalDepth() { global_depth_--; }
 
-auto HashTableDirectoryPage::GetBucketPageId(uint32_t bucket_idx) -> page_id_t { return bucket_page_ids_[bucket_idx]; }
+auto HashTableDirectoryPage::GetBucketPageId(uint32_t bucket_idx) const -> page_id_t {
+  return bucket_page_ids_[bucket_idx];
+}
 
 void HashTableDirectoryPage::SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id) { bucket_page_ids_[bucket_idx] = bucket_page_id; }
 
-auto HashTableDirectoryPage::GetSplitImageIndex(uint32_t bucket_idx) -> uint32_t {
+auto HashTableDirectoryPage::GetSplitImageIndex(uint32_t bucket_idx) const -> uint32_t {
   auto depth = GetLocalHighBit(bucket_idx);
   if((bucket_idx & depth) > 0)
     return (bucket_idx - depth);
   return (bucket_idx + depth);
 }
 
-auto HashTableDirectoryPage::Size() -> uint32_t { return 1<<global_depth_; }
+auto HashTableDirectoryPage::Size() const -> uint32_t { return 1<<global_depth_; }
 
-auto HashTableDirectoryPage::CanShrink() -> bool { 
+auto HashTableDirectoryPage::CanShrink() const -> bool { 
   for(uint32_t i = 0; i < Size(); i++) {
     if(local_depths_[i] >= global_depth_)
       return false;
@@ -53,9 +55,11 @@ auto HashTableDirectoryPage::CanShrink() -> bool {
   return true;
 }
 
-auto HashTableDirectoryPage::GetLocalDepth(uint32_t bucket_idx) -> uint32_t { return local_depths_[bucket_idx]; }
+auto HashTableDirectoryPage::GetLocalDepth(uint32_t bucket_idx) const -> uint32_t { return local_depths_[bucket_idx]; }
 
-auto HashTableDirectoryPage::GetLocalDepthMask(uint32_t bucket_idx) -> uint32_t { return (1<<local_depths_[bucket_idx]) - 1; }
+auto HashTableDirectoryPage::GetLocalDepthMask(uint32_t bucket_idx) const -> uint32_t {
+  return (1<<local_depths_[bucket_idx]) - 1;
+}
 
 void HashTableDirectoryPage::SetLocalDepth(uint32_t bucket_idx, uint8_t local_depth) { local_depths_[bucket_idx] = local_depth; }
 
@@ -63,7 +67,7 @@ void HashTableDirectoryPage::IncrLocalDepth(uint32_t bucket_idx) { local_depths_
 
 void HashTableDirectoryPage::DecrLocalDepth(uint32_t bucket_idx) { local_depths_[bucket_idx]--; }
 
-auto HashTableDirectoryPage::GetLocalHighBit(uint32_t bucket_idx) -> uint32_t { 
+auto HashTableDirectoryPage::GetLocalHighBit(uint32_t bucket_idx) const -> uint32_t { 
   return 1 << (local_depths_[bucket_idx] - 1);
 }
 
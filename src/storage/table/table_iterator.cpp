@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <utility>
 
 #include "storage/table/table_heap.h"
 
@@ -35,19 +36,24 @@ auto TableIterator::operator->() -> Tuple * {
 
 auto TableIterator::operator++() -> TableIterator & {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  ReadPageGuard cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId());
+  assert(cur_guard);  // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(cur_guard.GetPage());
+  if (pages_until_read_ahead_ == 0) {
+    ReadAhead(cur_page);
+  }
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      // Latch the next page before releasing the current one.
+      ReadPageGuard next_guard = buffer_pool_manager->FetchPageRead(cur_page->GetNextPageId());
+      cur_guard = std::move(next_guard);
+      cur_page = static_cast<TablePage *>(cur_guard.GetPage());
+      if (--pages_until_read_ahead_ == 0) {
+        ReadAhead(cur_page);
+      }
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -55,15 +61,22 @@ auto TableIterator::operator++() -> TableIterator & {
   }
   tuple_->rid_ = next_tuple_rid;
 
+  // The next tuple is on the page we hold, so copy it from there rather than fetching the page again.
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    cur_page->GetTuple(tuple_->rid_, tuple_, txn_, table_heap_->lock_manager_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
+void TableIterator::ReadAhead(TablePage *page) {
+  // Issue the next request halfway through the current window, so that the pages beyond it are on their way before
+  // the scan gets there. The first half of the new window is mostly resident already and costs the prefetcher a hit.
+  pages_until_read_ahead_ = READ_AHEAD_PAGES / 2;
+  table_heap_->buffer_pool_manager_->PrefetchChain(page->GetNextPageId(), READ_AHEAD_PAGES, [](Page *next_page) {
+    return static_cast<TablePage *>(next_page)->GetNextPageId();
+  });
+}
+
 auto TableIterator::operator++(int) -> TableIterator {
   TableIterator clone(*this);
   ++(*this);
@@ -0,0 +1,566 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_benchmark_test.cpp
+//
+// Identification: test/buffer/buffer_pool_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+// Throughput benchmarks for the buffer pool. They are disabled by default because their numbers only mean something
+// on an otherwise idle machine; run them with
+//   ./test/buffer_pool_manager_benchmark_test --gtest_also_run_disabled_tests
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "common/numa.h"
+#include "common/util/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/** Run `work(thread_id)` on num_threads threads and return the wall clock time in seconds. */
+template <typename Work>
+auto RunThreads(int num_threads, Work work) -> double {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back(work, tid);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** @return the resident set size of this process in bytes */
+auto GetResidentSetSize() -> size_t {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      return std::stoul(line.substr(6)) * 1024;
+    }
+  }
+  return 0;
+}
+
+/** @return how many bytes of a file are held in the kernel page cache */
+auto GetPageCacheSize(const std::string &file_name) -> size_t {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  off_t size = lseek(fd, 0, SEEK_END);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  size_t os_page_size = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((size + os_page_size - 1) / os_page_size);
+  mincore(data, size, resident.data());
+  munmap(data, size);
+  close(fd);
+  return std::count_if(resident.begin(), resident.end(), [](unsigned char r) { return (r & 1) != 0; }) *
+         os_page_size;
+}
+
+/** Write back a file and drop it from the kernel page cache. */
+void EvictFromPageCache(const std::string &file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_FetchHitScalingTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 1024;
+  const int num_pages = 1024;
+  const int ops_per_thread = 1000000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "hits/sec" << std::endl;
+  const int max_threads = std::max(4U, std::thread::hardware_concurrency());
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    double seconds = RunThreads(num_threads, [bpm](int tid) {
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+      for (int i = 0; i < ops_per_thread; ++i) {
+        page_id_t page_id = page_dist(rng);
+        bpm->FetchPage(page_id);
+        bpm->UnpinPage(page_id, false);
+      }
+    });
+    std::cout << std::setw(8) << num_threads << std::setw(16) << std::fixed << std::setprecision(0)
+              << num_threads * ops_per_thread / seconds << std::endl;
+  }
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bench.log");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_PageGuardTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 1024;
+  const int num_pages = 1024;
+  const int ops_per_thread = 1000000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // Both variants pin and read-latch a resident page; the guard unpins by frame instead of by page id.
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "unpin by id" << std::setw(16) << "page guard"
+            << std::endl;
+  const int max_threads = std::max(4U, std::thread::hardware_concurrency());
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    std::cout << std::setw(8) << num_threads;
+    for (bool guarded : {false, true}) {
+      double seconds = RunThreads(num_threads, [bpm, guarded](int tid) {
+        std::default_random_engine rng(tid);
+        std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+        for (int i = 0; i < ops_per_thread; ++i) {
+          page_id_t page_id = page_dist(rng);
+          if (guarded) {
+            ReadPageGuard guard = bpm->FetchPageRead(page_id);
+          } else {
+            Page *page = bpm->FetchPage(page_id);
+            page->RLatch();
+            page->RUnlatch();
+            bpm->UnpinPage(page_id, false);
+          }
+        }
+      });
+      std::cout << std::setw(16) << std::fixed << std::setprecision(0) << num_threads * ops_per_thread / seconds;
+    }
+    std::cout << std::endl;
+  }
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bench.log");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_ScanResistanceTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 64;
+  const int num_hot_pages = 48;
+  const int num_scan_pages = 2048;
+  const int num_lookups = 200000;
+  // How many table pages the scan advances between two point lookups.
+  const int scan_pages_per_lookup = 2;
+
+  std::cout << std::setw(8) << "policy" << std::setw(16) << "lookup hits" << std::setw(16) << "scan hits"
+            << std::setw(16) << "fetches/sec" << std::endl;
+  for (auto [name, replacer_type] : {std::make_pair("LRU", ReplacerType::LRU),
+                                     std::make_pair("LRU-K", ReplacerType::LRU_K)}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+    // Pages [0, num_hot_pages) stand in for index pages, the rest for a large table.
+    for (int i = 0; i < num_hot_pages + num_scan_pages; ++i) {
+      page_id_t page_id;
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      bpm->UnpinPage(page_id, true);
+    }
+    bpm->FlushAllPages();
+
+    // The scan and the lookups are interleaved at a fixed ratio in one thread, so that the hit rate of each stream
+    // can be attributed exactly and does not depend on how the OS schedules threads.
+    std::default_random_engine rng(0);
+    std::uniform_int_distribution<page_id_t> page_dist(0, num_hot_pages - 1);
+    page_id_t scan_page_id = num_hot_pages;
+    int lookup_misses = 0;
+    int scan_misses = 0;
+    auto fetch = [&](page_id_t page_id, int *misses) {
+      int reads = disk_manager->GetNumReads();
+      if (bpm->FetchPage(page_id) != nullptr) {
+        bpm->UnpinPage(page_id, false);
+      }
+      *misses += disk_manager->GetNumReads() - reads;
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_lookups; ++i) {
+      fetch(page_dist(rng), &lookup_misses);
+      for (int j = 0; j < scan_pages_per_lookup; ++j) {
+        fetch(scan_page_id, &scan_misses);
+        scan_page_id = scan_page_id + 1 < num_hot_pages + num_scan_pages ? scan_page_id + 1 : num_hot_pages;
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int num_scan_fetches = num_lookups * scan_pages_per_lookup;
+    std::cout << std::setw(8) << name << std::setw(16) << std::fixed << std::setprecision(3)
+              << 1.0 - static_cast<double>(lookup_misses) / num_lookups << std::setw(16)
+              << 1.0 - static_cast<double>(scan_misses) / num_scan_fetches << std::setw(16) << std::setprecision(0)
+              << (num_lookups + num_scan_fetches) / seconds << std::endl;
+
+    disk_manager->ShutDown();
+    remove(db_name.c_str());
+    remove("bench.log");
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_DirectIOTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 4096;
+  const int num_pages = 16384;
+  const int num_fetches = 200000;
+
+  {
+    DiskManager disk_manager(db_name);
+    std::vector<char> data(PAGE_SIZE, 'x');
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      disk_manager.WritePage(page_id, data.data());
+    }
+    disk_manager.ShutDown();
+  }
+
+  std::cout << std::setw(12) << "direct I/O" << std::setw(16) << "fetches/sec" << std::setw(12) << "RSS MiB"
+            << std::setw(16) << "page cache MiB" << std::endl;
+  for (bool direct_io : {false, true}) {
+    EvictFromPageCache(db_name);
+    auto *disk_manager = new DiskManager(db_name, direct_io);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+    // Uniform random reads over a data set four times the size of the pool.
+    std::default_random_engine rng(0);
+    std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_fetches; ++i) {
+      page_id_t page_id = page_dist(rng);
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      bpm->UnpinPage(page_id, false);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::setw(12) << (disk_manager->IsDirectIO() ? "on" : "off") << std::setw(16) << std::fixed
+              << std::setprecision(0) << num_fetches / seconds << std::setw(12) << std::setprecision(1)
+              << GetResidentSetSize() / 1048576.0 << std::setw(16) << GetPageCacheSize(db_name) / 1048576.0
+              << std::endl;
+
+    disk_manager->ShutDown();
+    delete bpm;
+    delete disk_manager;
+  }
+
+  remove(db_name.c_str());
+  remove("bench.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_ChecksumFetchTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 4096;
+  const int num_pages = 16384;
+  const int num_fetches = 1000000;
+  const int num_rounds = 10;
+
+  {
+    DiskManager disk_manager(db_name);
+    std::default_random_engine rng(0);
+    std::vector<char> data(PAGE_SIZE);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      std::generate(data.begin(), data.end(), [&rng] { return static_cast<char>(rng()); });
+      disk_manager.WritePage(page_id, data.data());
+    }
+    disk_manager.ShutDown();
+  }
+
+  std::vector<char> page(PAGE_SIZE, 'x');
+  uint32_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_fetches; ++i) {
+    checksum ^= Crc32c::Value(page.data(), PAGE_SIZE);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double checksum_seconds = seconds / num_fetches;
+  std::cout << "CRC32C (" << (Crc32c::IsHardwareAccelerated() ? "SSE4.2" : "software") << "): " << std::fixed
+            << std::setprecision(0) << seconds / num_fetches * 1e9 << " ns/page " << std::setprecision(2)
+            << num_fetches * static_cast<double>(PAGE_SIZE) / seconds / 1e9 << " GB/s (" << checksum << ")"
+            << std::endl;
+
+  // Fetches from a data set four times the size of the pool. Uniform fetches miss 3 in 4 times, from the kernel page
+  // cache or, with direct I/O, from the device; cached misses are the worst case for the checksum, as no device time
+  // hides it. Skewed fetches send 99% of the fetches to a hot set that fits in the pool. Best of a few alternating
+  // rounds, to tame noise. The measured cost is noisy on a busy machine; the time spent checksumming, i.e. the
+  // number of page reads times the cost of a checksum, is not.
+  struct Workload {
+    const char *name_;
+    bool skewed_;
+    bool direct_io_;
+    int num_fetches_;
+  };
+  std::cout << std::setw(12) << "workload" << std::setw(10) << "hit rate" << std::setw(16) << "off fetches/s"
+            << std::setw(16) << "on fetches/s" << std::setw(10) << "cost" << std::setw(14) << "checksumming"
+            << std::endl;
+  for (const Workload &workload : {Workload{"cached", false, false, num_fetches},
+                                   Workload{"direct I/O", false, true, num_fetches / 20},
+                                   Workload{"hot set", true, false, num_fetches}}) {
+    double best[2] = {0, 0};
+    double hit_rate = 0;
+    double checksum_share = 0;
+    for (int round = 0; round < num_rounds; ++round) {
+      for (bool checksums : {false, true}) {
+        auto *disk_manager = new DiskManager(db_name, workload.direct_io_);
+        disk_manager->SetChecksums(checksums);
+        auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+        std::default_random_engine rng(round);
+        std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+        std::uniform_int_distribution<page_id_t> hot_dist(0, buffer_pool_size / 2 - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < workload.num_fetches_; ++i) {
+          page_id_t page_id = workload.skewed_ && percent(rng) < 99 ? hot_dist(rng) : page_dist(rng);
+          ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+          bpm->UnpinPage(page_id, false);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best[checksums ? 1 : 0] = std::max(best[checksums ? 1 : 0], workload.num_fetches_ / seconds);
+        hit_rate = 1 - static_cast<double>(disk_manager->GetNumReads()) / workload.num_fetches_;
+        if (checksums) {
+          checksum_share = std::max(checksum_share, disk_manager->GetNumReads() * checksum_seconds / seconds);
+        }
+        EXPECT_EQ(0, disk_manager->GetNumChecksumFailures());
+        disk_manager->ShutDown();
+        delete bpm;
+        delete disk_manager;
+      }
+    }
+    std::cout << std::setw(12) << workload.name_ << std::setw(9) << std::setprecision(1) << hit_rate * 100 << "%"
+              << std::setw(16) << std::setprecision(0) << best[0] << std::setw(16) << best[1] << std::setw(9)
+              << std::setprecision(2) << (best[0] / best[1] - 1) * 100 << "%" << std::setw(13) << checksum_share * 100
+              << "%" << std::endl;
+  }
+
+  remove(db_name.c_str());
+  remove("bench.log");
+  remove("bench.crc");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_CheckpointFlushTest) {
+  const std::string db_name = "bench.db";
+  const size_t pool_size = 16384;
+  const int num_rounds = 10;
+
+  std::cout << std::setw(12) << "instances" << std::setw(12) << "flush" << std::setw(16) << "pages/sec" << std::endl;
+  for (size_t num_instances : {1, 4}) {
+    for (bool grouped : {false, true}) {
+      auto *disk_manager = new DiskManager(db_name);
+      auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size / num_instances, disk_manager);
+      std::vector<page_id_t> page_ids;
+      for (size_t i = 0; i < pool_size; ++i) {
+        page_id_t page_id;
+        ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+        bpm->UnpinPage(page_id, true);
+        page_ids.push_back(page_id);
+      }
+
+      double seconds = 0;
+      std::default_random_engine rng(0);
+      for (int round = 0; round < num_rounds; ++round) {
+        // Dirty every page in random order, as a workload between two checkpoints would.
+        std::shuffle(page_ids.begin(), page_ids.end(), rng);
+        for (page_id_t page_id : page_ids) {
+          bpm->FetchPage(page_id)->GetData()[0] = static_cast<char>(round);
+          bpm->UnpinPage(page_id, true);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (grouped) {
+          bpm->FlushAllPages();
+        } else {
+          // One write per page in no particular order, as FlushAllPages used to do.
+          for (page_id_t page_id : page_ids) {
+            bpm->FlushPage(page_id);
+          }
+        }
+        int fd = open(db_name.c_str(), O_RDONLY);
+        fdatasync(fd);
+        close(fd);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+
+      std::cout << std::setw(12) << num_instances << std::setw(12) << (grouped ? "grouped" : "per page")
+                << std::setw(16) << std::fixed << std::setprecision(0) << num_rounds * pool_size / seconds << std::endl;
+
+      disk_manager->ShutDown();
+      remove(db_name.c_str());
+      remove("bench.log");
+      delete bpm;
+      delete disk_manager;
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_NumaPlacementTest) {
+  const std::string db_name = "bench.db";
+  const size_t num_instances = 4;
+  const size_t pool_size = 1024;
+  const int pages_per_thread = 512;
+  const int fetches_per_thread = 500000;
+
+  // On a single-node machine two nodes are emulated: every thread is assigned to one of them, and locality shows up
+  // in the remote fetch counts rather than in the timings.
+  bool emulated = NumaUtil::GetNumNodes() == 1;
+  if (emulated) {
+    NumaUtil::EmulateNodes(2);
+  }
+  const int num_nodes = NumaUtil::GetNumNodes();
+  const int num_threads = 2 * num_nodes;
+
+  std::cout << "nodes: " << num_nodes << (emulated ? " (emulated)" : "") << std::endl;
+  for (bool numa_aware : {false, true}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size, disk_manager, nullptr, ReplacerType::LRU,
+                                              numa_aware);
+    // Every thread works on pages it created itself, like a session filling and reading its own temporary table.
+    double seconds = RunThreads(num_threads, [&](int tid) {
+      if (emulated) {
+        NumaUtil::SetCurrentNode(tid % num_nodes);
+      }
+      std::vector<page_id_t> page_ids;
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id;
+        ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+        bpm->UnpinPage(page_id, true);
+        page_ids.push_back(page_id);
+      }
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<size_t> page_dist(0, page_ids.size() - 1);
+      for (int i = 0; i < fetches_per_thread; ++i) {
+        page_id_t page_id = page_ids[page_dist(rng)];
+        bpm->FetchPage(page_id);
+        bpm->UnpinPage(page_id, false);
+      }
+    });
+
+    std::cout << "numa-aware " << (numa_aware ? "on" : "off") << ": " << std::fixed << std::setprecision(0)
+              << num_threads * fetches_per_thread / seconds << " fetches/sec" << std::endl;
+    // Without NUMA awareness the instances are on no node in particular, so there is nothing to break down.
+    if (!numa_aware) {
+      disk_manager->ShutDown();
+      remove(db_name.c_str());
+      remove("bench.log");
+      delete bpm;
+      delete disk_manager;
+      continue;
+    }
+    std::cout << std::setw(8) << "node" << std::setw(12) << "hits" << std::setw(12) << "misses" << std::setw(12)
+              << "remote %" << std::endl;
+    auto stats = bpm->GetNumaNodeStats();
+    for (int node = 0; node < num_nodes; ++node) {
+      uint64_t fetches = stats[node].hits_ + stats[node].misses_;
+      std::cout << std::setw(8) << node << std::setw(12) << stats[node].hits_ << std::setw(12) << stats[node].misses_
+                << std::setw(12) << std::setprecision(1)
+                << (fetches == 0 ? 0.0 : 100.0 * stats[node].remote_fetches_ / fetches) << std::endl;
+    }
+
+    disk_manager->ShutDown();
+    remove(db_name.c_str());
+    remove("bench.log");
+    delete bpm;
+    delete disk_manager;
+  }
+  NumaUtil::EmulateNodes(0);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DISABLED_SkewedInstanceTest) {
+  const std::string db_name = "bench.db";
+  const size_t num_instances = 4;
+  const size_t pool_size = 256;
+  const int num_pages = 4096;
+  // The hot set is 384 pages that all live on instance 0: more than its share of frames, less than the whole pool.
+  const int num_hot_pages = 384;
+  const int num_threads = 4;
+  const int fetches_per_thread = 250000;
+
+  for (bool rebalancing : {false, true}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size, disk_manager, nullptr, ReplacerType::LRU, false,
+                                              rebalancing);
+    for (int i = 0; i < num_pages; ++i) {
+      page_id_t page_id;
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      bpm->UnpinPage(page_id, true);
+    }
+
+    // 90% of the fetches go to the hot set, the rest anywhere.
+    double seconds = RunThreads(num_threads, [&](int tid) {
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<int> percent_dist(0, 99);
+      std::uniform_int_distribution<page_id_t> hot_dist(0, num_hot_pages - 1);
+      std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+      for (int i = 0; i < fetches_per_thread; ++i) {
+        page_id_t page_id =
+            percent_dist(rng) < 90 ? hot_dist(rng) * static_cast<page_id_t>(num_instances) : page_dist(rng);
+        bpm->FetchPage(page_id);
+        bpm->UnpinPage(page_id, false);
+      }
+    });
+
+    auto stats = bpm->GetInstanceStats();
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    for (const auto &instance_stats : stats) {
+      hits += instance_stats.hits_;
+      misses += instance_stats.misses_;
+    }
+    std::cout << "rebalancing " << (rebalancing ? "on" : "off") << ": " << std::fixed << std::setprecision(0)
+              << num_threads * fetches_per_thread / seconds << " fetches/sec, hit rate " << std::setprecision(3)
+              << static_cast<double>(hits) / (hits + misses) << std::endl;
+    std::cout << std::setw(10) << "instance" << std::setw(10) << "frames" << std::setw(12) << "hits" << std::setw(12)
+              << "misses" << std::setw(14) << "latch waits" << std::setw(16) << "latch wait ms" << std::endl;
+    for (size_t i = 0; i < stats.size(); ++i) {
+      std::cout << std::setw(10) << i << std::setw(10) << stats[i].frames_ << std::setw(12) << stats[i].hits_
+                << std::setw(12) << stats[i].misses_ << std::setw(14) << stats[i].latch_waits_ << std::setw(16)
+                << std::setprecision(1) << stats[i].latch_wait_ns_ / 1e6 << std::endl;
+    }
+
+    disk_manager->ShutDown();
+    remove(db_name.c_str());
+    remove("bench.log");
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+}  // namespace bustub
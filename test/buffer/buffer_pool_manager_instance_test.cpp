@@ -14,6 +14,8 @@
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -141,4 +143,602 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+// Hammer a small pool from several threads so that hits race with evictions of the same frames.
+TEST(BufferPoolManagerInstanceTest, ConcurrentFetchUnpinTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const int num_pages = 32;
+  const int num_threads = 4;
+  const int rounds = 2000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Every page stores its own id so that a reader can tell whether it got the right frame.
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, page_id_temp);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = page_dist(rng);
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          // Every frame is pinned by the other threads right now.
+          continue;
+        }
+        EXPECT_EQ(page_id, page->GetPageId());
+        EXPECT_EQ(std::to_string(page_id), page->GetData());
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every pin was released, so every page can be deleted and unpinning again must fail.
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_FALSE(bpm->UnpinPage(i, false));
+    EXPECT_TRUE(bpm->DeletePage(i));
+  }
+  // Pages that were never allocated cannot be deleted, so they never reach the free page map.
+  EXPECT_FALSE(bpm->DeletePage(-1));
+  EXPECT_FALSE(bpm->DeletePage(num_pages));
+  EXPECT_EQ(num_pages, disk_manager->GetNumFreePages());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, BackgroundWriterTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the pool with dirty, unpinned pages.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: the background writer cleans every frame ahead of time.
+  bpm->RunBackgroundWriter(buffer_pool_size, std::chrono::milliseconds(1));
+  for (int i = 0; i < 1000 && bpm->GetCounters().background_writes_ < buffer_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetCounters().background_writes_);
+
+  // Scenario: replacing every page now only evicts clean frames.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  }
+  bpm->StopBackgroundWriter();
+  EXPECT_EQ(0, bpm->GetCounters().foreground_writes_);
+
+  // Scenario: the pages written by the background writer can be read back.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(std::to_string(page_id), page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DirtyVictimKeepsHistoryTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU_K);
+  // The writer never cleans anything on its own, but makes evictions pass over dirty victims.
+  bpm->RunBackgroundWriter(0, std::chrono::milliseconds(1000));
+
+  // Scenario: page 0 is hot and dirty, page 1 is hot and clean. Both have two accesses; page 0's are older.
+  page_id_t page_ids[3];
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], true));
+  }
+  bpm->FlushPage(page_ids[1]);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], i == 0));
+  }
+
+  // Scenario: a new page passes over dirty page 0 and evicts page 1. Page 0 goes back with both of its accesses.
+  ASSERT_NE(nullptr, bpm->NewPage(&page_ids[2]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[2], false));
+  EXPECT_EQ(0, bpm->GetCounters().foreground_writes_);
+
+  // Scenario: with the writer gone, dirty pages are fair game. The next miss still evicts the new page, which has a
+  // single access, rather than hot page 0.
+  bpm->StopBackgroundWriter();
+  int reads = disk_manager->GetNumReads();
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[1]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], false));
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  EXPECT_EQ(reads + 1, disk_manager->GetNumReads());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushAllPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the pool with dirty pages, keeping the even ones pinned.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    if (page_id_temp % 2 == 1) {
+      EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+    }
+  }
+
+  // Scenario: every dirty page is written once, and the pins are left as they were.
+  int writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + static_cast<int>(buffer_pool_size), disk_manager->GetNumWrites());
+  Page *pages = bpm->GetPages();
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_FALSE(pages[i].IsDirty());
+    EXPECT_EQ(pages[i].GetPageId() % 2 == 0 ? 1 : 0, pages[i].GetPinCount());
+  }
+
+  // Scenario: clean pages are not written again.
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + static_cast<int>(buffer_pool_size), disk_manager->GetNumWrites());
+
+  // Scenario: a page dirtied again is written again.
+  EXPECT_TRUE(bpm->UnpinPage(0, true));
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + static_cast<int>(buffer_pool_size) + 1, disk_manager->GetNumWrites());
+
+  // Scenario: the flushed pages can be read back from disk.
+  std::vector<char> data(PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    disk_manager->ReadPage(page_id, data.data());
+    EXPECT_EQ(std::to_string(page_id), data.data());
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FrameBudgetTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the pool with dirty pages, keeping pages 0 and 1 pinned.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    if (page_id_temp > 1) {
+      EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+    }
+  }
+
+  // Scenario: shrinking evicts unpinned pages, but stops at the pinned ones.
+  EXPECT_EQ(4, bpm->SetFrameBudget(4));
+  EXPECT_EQ(4, bpm->GetPoolSize());
+  EXPECT_EQ(2, bpm->SetFrameBudget(0));
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: growing is capped at the pool size, and the evicted pages were written back.
+  EXPECT_TRUE(bpm->UnpinPage(0, true));
+  EXPECT_TRUE(bpm->UnpinPage(1, true));
+  EXPECT_EQ(buffer_pool_size, bpm->SetFrameBudget(2 * buffer_pool_size));
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(std::to_string(page_id), page->GetData());
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, StatsTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->SetLatencyTracking(true);
+
+  // Scenario: six new pages through four frames; page 0 stays pinned twice, the others are unpinned dirty.
+  for (int i = 0; i < 6; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    if (page_id_temp > 0) {
+      EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+    }
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  // Pages 1 and 2 were evicted; page 1 is read back in and evicts page 3.
+  ASSERT_NE(nullptr, bpm->FetchPage(1));
+  EXPECT_TRUE(bpm->UnpinPage(1, false));
+  EXPECT_TRUE(bpm->FlushPage(4));
+  EXPECT_TRUE(bpm->DeletePage(5));
+
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size, stats.frames_);
+  EXPECT_EQ(3, stats.resident_pages_);
+  EXPECT_EQ(1, stats.dirty_pages_);
+  EXPECT_EQ(2, stats.pin_counts_[0]);
+  EXPECT_EQ(1, stats.pin_counts_[2]);
+  EXPECT_EQ(6, stats.new_pages_);
+  EXPECT_EQ(1, stats.deleted_pages_);
+  EXPECT_EQ(1, stats.hits_);
+  EXPECT_EQ(1, stats.misses_);
+  EXPECT_EQ(3, stats.evictions_);
+  EXPECT_EQ(3, stats.foreground_writes_);
+  EXPECT_EQ(1, stats.flush_writes_);
+  EXPECT_DOUBLE_EQ(0.5, stats.HitRatio());
+  EXPECT_EQ(2, stats.fetch_latency_.count_);
+  EXPECT_EQ(6, stats.new_page_latency_.count_);
+  EXPECT_EQ(1, stats.flush_latency_.count_);
+  EXPECT_LE(stats.fetch_latency_.Percentile(0.5), stats.fetch_latency_.Percentile(1));
+  EXPECT_NE(std::string::npos, stats.ToString().find("hit_ratio=0.500"));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DeletePageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, 2, 1, disk_manager);
+
+  // Scenario: more pages than frames, so that some deleted pages are only on disk.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_TRUE(bpm->DeletePage(page_ids[5]));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[1]));
+
+  // Scenario: deleted pages cannot be fetched, whether they were resident or only on disk.
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[5]));
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[1]));
+
+  // Scenario: new pages reuse the deleted ones, lowest first, zeroed, before the file grows.
+  for (page_id_t expected : {page_ids[1], page_ids[5], page_ids.back() + 2}) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(expected, page_id_temp);
+    EXPECT_EQ(0, page->GetData()[0]);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const int num_pages = 128;
+  const int num_threads = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: with a pool much smaller than the data, almost every fetch is a miss. Threads that miss on the same page
+  // share one read and never see a half-read page.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+      for (int i = 0; i < 2000; ++i) {
+        page_id_t page_id = page_dist(rng);
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        EXPECT_EQ(std::to_string(page_id), page->GetData());
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DirectIOTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t num_pages = 50;
+
+  auto *disk_manager = new DiskManager(db_name, true);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: frames are aligned for direct I/O.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(bpm->GetPages()[i].GetData()) % DiskManager::DIRECT_IO_ALIGNMENT);
+  }
+
+  // Scenario: pages cycle through a pool much smaller than the data and survive eviction.
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(std::to_string(page_id), page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t num_pages = 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: pages [0, 20) form a chain through the first bytes of every page. Only the last 10 stay resident.
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    *reinterpret_cast<page_id_t *>(page->GetData()) = i + 1 < num_pages ? i + 1 : INVALID_PAGE_ID;
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: prefetch pages 0 and 1 by id, then the chain from page 2 on. Only 8 pages are read ahead, so that the
+  // prefetcher does not evict what it just read.
+  int reads = disk_manager->GetNumReads();
+  bpm->PrefetchPages({0, 1});
+  bpm->PrefetchChain(2, 6, [](Page *page) { return *reinterpret_cast<page_id_t *>(page->GetData()); });
+  for (int i = 0; i < 1000 && bpm->GetPrefetchCount() < 8; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(8, bpm->GetPrefetchCount());
+  EXPECT_EQ(reads + 8, disk_manager->GetNumReads());
+
+  // Scenario: fetching the prefetched pages does not touch the disk, and they are unpinned.
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_EQ(page_id + 1, *reinterpret_cast<page_id_t *>(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads + 8, disk_manager->GetNumReads());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, LruKPrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU_K);
+  for (page_id_t i = 0; i < 6; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: pages 0 and 1 are hot, with two accesses each.
+  for (page_id_t page_id : {0, 0, 1, 1}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: a scan reads pages 2 and 3 ahead, then fetches each of them once.
+  bpm->PrefetchPages({2, 3});
+  for (int i = 0; i < 1000 && bpm->GetPrefetchCount() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(2, bpm->GetPrefetchCount());
+  int reads = disk_manager->GetNumReads();
+  for (page_id_t page_id : {2, 3}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+
+  // Scenario: the read-ahead was not an access, so the scanned pages have a single one and the next miss evicts one
+  // of them rather than a hot page.
+  ASSERT_NE(nullptr, bpm->FetchPage(4));
+  EXPECT_TRUE(bpm->UnpinPage(4, false));
+  for (page_id_t page_id : {0, 1}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads + 1, disk_manager->GetNumReads());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FrameWaitTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_ids[3];
+  ASSERT_NE(nullptr, bpm->NewPage(&page_ids[0]));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_ids[1]));
+
+  // Scenario: without a timeout, a full pool still fails at once.
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_ids[2]));
+  EXPECT_EQ(0, bpm->GetStats().frame_waits_);
+
+  // Scenario: with a timeout, a full pool fails after waiting for it.
+  bpm->SetFrameWaitTimeout(std::chrono::milliseconds(20));
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_ids[2]));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(1, stats.frame_waits_);
+  EXPECT_EQ(1, stats.frame_wait_timeouts_);
+  EXPECT_GE(stats.frame_wait_ns_, 20'000'000);
+
+  // Scenario: a new page and a fetch wait until other threads unpin a page.
+  bpm->SetFrameWaitTimeout(std::chrono::seconds(10));
+  std::thread unpinner([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[0], true));
+  });
+  auto *page = bpm->NewPage(&page_ids[2]);
+  unpinner.join();
+  ASSERT_NE(nullptr, page);
+  unpinner = std::thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[2], false));
+  });
+  page = bpm->FetchPage(page_ids[0]);
+  unpinner.join();
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page_ids[0], page->GetPageId());
+  stats = bpm->GetStats();
+  EXPECT_EQ(3, stats.frame_waits_);
+  EXPECT_EQ(1, stats.frame_wait_timeouts_);
+  EXPECT_NE(std::string::npos, stats.ToString().find("frame_waits=3"));
+
+  // Scenario: two fetches of the same page wait for the one frame that is unpinned. The first reads the page in, the
+  // second finds it resident when it wakes up.
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < 2; ++i) {
+    waiters.emplace_back([&] {
+      auto *fetched = bpm->FetchPage(page_ids[2]);
+      ASSERT_NE(nullptr, fetched);
+      EXPECT_EQ(page_ids[2], fetched->GetPageId());
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[2], false));
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], false));
+  for (auto &waiter : waiters) {
+    waiter.join();
+  }
+  stats = bpm->GetStats();
+  EXPECT_GE(stats.frame_waits_, 4);
+  EXPECT_EQ(1, stats.frame_wait_timeouts_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
@@ -19,7 +19,7 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -57,6 +57,72 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(6, value);
   clock_replacer.Victim(&value);
   EXPECT_EQ(4, value);
+  EXPECT_FALSE(clock_replacer.Victim(&value));
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, LargePoolTest) {
+  const size_t num_frames = 1000;
+  ClockReplacer clock_replacer(num_frames);
+
+  // Scenario: only a few frames spread over different bitmap words are evictable. The sweep has to find them across
+  // words and wrap around past the partially used last word.
+  clock_replacer.Unpin(999);
+  clock_replacer.Unpin(40);
+  clock_replacer.Unpin(0);
+  EXPECT_EQ(3, clock_replacer.Size());
+
+  int value;
+  ASSERT_TRUE(clock_replacer.Victim(&value));
+  EXPECT_EQ(0, value);
+  ASSERT_TRUE(clock_replacer.Victim(&value));
+  EXPECT_EQ(40, value);
+  ASSERT_TRUE(clock_replacer.Victim(&value));
+  EXPECT_EQ(999, value);
+  EXPECT_FALSE(clock_replacer.Victim(&value));
+
+  // Scenario: a frame that is pinned again before the hand reaches it is never returned.
+  clock_replacer.Unpin(500);
+  clock_replacer.Unpin(501);
+  clock_replacer.Pin(500);
+  ASSERT_TRUE(clock_replacer.Victim(&value));
+  EXPECT_EQ(501, value);
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, ConcurrencyTest) {
+  const int num_threads = 8;
+  const int frames_per_thread = 100;
+  ClockReplacer clock_replacer(num_threads * frames_per_thread);
+
+  // Scenario: threads unpin and pin their own frames concurrently. Frames that end up unpinned are all evictable
+  // exactly once.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&clock_replacer, tid] {
+      for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < frames_per_thread; i++) {
+          clock_replacer.Unpin(tid * frames_per_thread + i);
+        }
+        for (int i = 0; i < frames_per_thread; i += 2) {
+          clock_replacer.Pin(tid * frames_per_thread + i);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * frames_per_thread / 2, clock_replacer.Size());
+
+  std::vector<bool> seen(num_threads * frames_per_thread, false);
+  int value;
+  while (clock_replacer.Victim(&value)) {
+    EXPECT_EQ(1, value % 2);
+    EXPECT_FALSE(seen[value]);
+    seen[value] = true;
+  }
+  EXPECT_EQ(0, clock_replacer.Size());
 }
 
 }  // namespace bustub
@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer_test.cpp
+//
+// Identification: test/buffer/intrusive_lru_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/intrusive_lru_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(IntrusiveLRUReplacerTest, SampleTest) {
+  IntrusiveLRUReplacer lru_replacer(7);
+  // Scenario: unpin six elements, i.e. add them to the replacer.
+  lru_replacer.Unpin(1);
+  lru_replacer.Unpin(2);
+  lru_replacer.Unpin(3);
+  lru_replacer.Unpin(4);
+  lru_replacer.Unpin(5);
+  lru_replacer.Unpin(6);
+  lru_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_replacer.Size());
+
+  // Scenario: get three victims from the lru.
+  int value;
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+
+  // Scenario: pin elements in the replacer.
+  // Note that 3 has already been victimized, so pinning 3 should have no effect.
+  lru_replacer.Pin(3);
+  lru_replacer.Pin(4);
+  EXPECT_EQ(2, lru_replacer.Size());
+
+  // Scenario: unpin 4, which makes it the most recently used frame.
+  lru_replacer.Unpin(4);
+  EXPECT_EQ(3, lru_replacer.Size());
+  // Scenario: continue looking for victims. We expect these victims.
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_replacer.Size());
+
+  // Scenario: frame 0 and the last frame are valid, and a drained list can be reused.
+  lru_replacer.Unpin(6);
+  lru_replacer.Unpin(0);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+}
+
+TEST(IntrusiveLRUReplacerTest, MatchesLRUReplacerTest) {
+  const size_t num_frames = 64;
+  IntrusiveLRUReplacer intrusive_replacer(num_frames);
+  LRUReplacer lru_replacer(num_frames);
+
+  // Scenario: a random mix of operations produces the same victims and sizes on both implementations.
+  std::default_random_engine rng(15445);
+  std::uniform_int_distribution<frame_id_t> frame_dist(0, num_frames - 1);
+  std::uniform_int_distribution<int> op_dist(0, 2);
+  for (int i = 0; i < 100000; i++) {
+    frame_id_t frame_id = frame_dist(rng);
+    switch (op_dist(rng)) {
+      case 0:
+        intrusive_replacer.Pin(frame_id);
+        lru_replacer.Pin(frame_id);
+        break;
+      case 1:
+        intrusive_replacer.Unpin(frame_id);
+        lru_replacer.Unpin(frame_id);
+        break;
+      default: {
+        frame_id_t expected = -1;
+        frame_id_t actual = -1;
+        ASSERT_EQ(lru_replacer.Victim(&expected), intrusive_replacer.Victim(&actual));
+        ASSERT_EQ(expected, actual);
+      }
+    }
+    ASSERT_EQ(lru_replacer.Size(), intrusive_replacer.Size());
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: frames 1-6 are loaded (one access each) and unpinned. Frame 1 is then used a second time.
+  for (frame_id_t frame_id = 1; frame_id <= 6; frame_id++) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames with a single access go first, oldest first. Frame 1 is the most recently used frame under plain
+  // LRU but has a finite K-distance, so it survives.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: pinning removes frames from consideration; 3 has already been victimized, so pinning it has no effect
+  // on the size.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(5);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+
+  // Scenario: frame 5 now has two accesses as well. Frame 6 still has one and goes first; then frame 1, whose
+  // second-to-last access is older than frame 5's.
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  LRUKReplacer lru_k_replacer(10, 2);
+
+  // Scenario: frames 0 and 1 hold hot pages that are referenced over and over.
+  for (int i = 0; i < 3; i++) {
+    lru_k_replacer.Pin(0);
+    lru_k_replacer.Unpin(0);
+    lru_k_replacer.Pin(1);
+    lru_k_replacer.Unpin(1);
+  }
+
+  // Scenario: a scan touches frames 2-9 exactly once, after the hot pages.
+  for (frame_id_t frame_id = 2; frame_id < 10; frame_id++) {
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  // Scenario: every scanned frame is evicted before either hot frame.
+  int value;
+  for (frame_id_t frame_id = 2; frame_id < 10; frame_id++) {
+    ASSERT_TRUE(lru_k_replacer.Victim(&value));
+    EXPECT_EQ(frame_id, value);
+  }
+
+  // Scenario: a removed frame loses its history and is gone from the replacer.
+  lru_k_replacer.Remove(0);
+  EXPECT_EQ(1, lru_k_replacer.Size());
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+}
+
+}  // namespace bustub
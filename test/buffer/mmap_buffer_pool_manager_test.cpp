@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager_test.cpp
+//
+// Identification: test/buffer/mmap_buffer_pool_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/mmap_buffer_pool_manager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(MmapBufferPoolManagerTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const page_id_t num_pages = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  std::vector<char> data(PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    snprintf(data.data(), PAGE_SIZE, "page %d", page_id);
+    disk_manager->WritePage(page_id, data.data());
+  }
+  auto *bpm = new MmapBufferPoolManager(disk_manager);
+
+  // Scenario: every page of the file is available, and its data points into the mapping.
+  EXPECT_EQ(static_cast<size_t>(num_pages), bpm->GetPoolSize());
+  auto *page3 = bpm->FetchPage(3);
+  ASSERT_NE(nullptr, page3);
+  EXPECT_EQ(3, page3->GetPageId());
+  EXPECT_EQ(0, strcmp(page3->GetData(), "page 3"));
+  EXPECT_EQ(1, page3->GetPinCount());
+  EXPECT_FALSE(page3->IsDirty());
+
+  // Scenario: fetching a page again returns the same Page and adds a pin.
+  EXPECT_EQ(page3, bpm->FetchPage(3));
+  EXPECT_EQ(2, page3->GetPinCount());
+  EXPECT_TRUE(bpm->UnpinPage(3, false));
+  EXPECT_TRUE(bpm->UnpinPage(3, false));
+  EXPECT_FALSE(bpm->UnpinPage(3, false));
+
+  // Scenario: all pages can be pinned at once; there is nothing to evict.
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), page->GetData());
+  }
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: the buffer pool is read-only and ends where the file ended.
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_FALSE(bpm->DeletePage(3));
+  EXPECT_EQ(nullptr, bpm->FetchPage(num_pages));
+  EXPECT_EQ(nullptr, bpm->FetchPage(INVALID_PAGE_ID));
+  EXPECT_TRUE(bpm->FlushPage(3));
+  bpm->FlushAllPages();
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -14,7 +14,10 @@
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
+#include "common/numa.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -154,4 +157,239 @@ TEST(ParallelBufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FlushAllPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const size_t num_instances = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Scenario: fill every instance with dirty pages.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    page_id_t page_id_temp;
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+    page_ids.push_back(page_id_temp);
+  }
+
+  // Scenario: the pages of all instances are written once, and a second flush finds nothing to write.
+  int writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + static_cast<int>(page_ids.size()), disk_manager->GetNumWrites());
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + static_cast<int>(page_ids.size()), disk_manager->GetNumWrites());
+
+  std::vector<char> data(PAGE_SIZE);
+  for (page_id_t page_id : page_ids) {
+    disk_manager->ReadPage(page_id, data.data());
+    EXPECT_EQ(std::to_string(page_id), data.data());
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, NumaTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const size_t num_instances = 4;
+
+  // Scenario: two emulated nodes, so instances 0 and 2 sit on node 0 and instances 1 and 3 on node 1.
+  NumaUtil::EmulateNodes(2);
+  NumaUtil::SetCurrentNode(1);
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU,
+                                            true);
+
+  // Scenario: new pages come from the instances on the caller's node until they are full.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(1, page_id_temp % 2);
+    page_ids.push_back(page_id_temp);
+  }
+  page_id_t page_id_temp;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(0, page_id_temp % 2);
+  EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  for (page_id_t page_id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: fetches are counted on the node of the instance that holds the page, and a fetch from another node is
+  // counted as remote.
+  EXPECT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  NumaUtil::SetCurrentNode(0);
+  EXPECT_NE(nullptr, bpm->FetchPage(page_ids[1]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], false));
+  auto stats = bpm->GetNumaNodeStats();
+  ASSERT_EQ(2, stats.size());
+  EXPECT_EQ(0, stats[0].hits_ + stats[0].misses_);
+  EXPECT_EQ(0, stats[0].remote_fetches_);
+  EXPECT_EQ(2, stats[1].hits_);
+  EXPECT_EQ(0, stats[1].misses_);
+  EXPECT_EQ(1, stats[1].remote_fetches_);
+  bpm->FlushAllPages();
+  delete bpm;
+
+  // Scenario: a pool is not NUMA-aware unless asked to be. It binds no instance to a node and counts no fetch on one.
+  bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+  for (page_id_t page_id : page_ids) {
+    EXPECT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  for (const auto &node_stats : bpm->GetNumaNodeStats()) {
+    EXPECT_EQ(0, node_stats.hits_ + node_stats.misses_ + node_stats.remote_fetches_);
+  }
+
+  NumaUtil::SetCurrentNode(-1);
+  NumaUtil::EmulateNodes(0);
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, RebalanceFramesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU,
+                                            false, true);
+  // The rounds are run by hand below rather than by the rebalancing thread.
+  bpm->SetFrameRebalancing(false);
+
+  // Scenario: 32 pages, half of them on each instance.
+  for (size_t i = 0; i < 32; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  bpm->RebalanceFrames();
+
+  // Scenario: only pages of instance 0 are used, so its misses pull frames over from instance 1, one step per round,
+  // until instance 1 is down to a quarter of its size.
+  for (int round = 0; round < 10; ++round) {
+    for (page_id_t page_id = 0; page_id < 32; page_id += 2) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+    bpm->RebalanceFrames();
+  }
+  auto stats = bpm->GetInstanceStats();
+  ASSERT_EQ(num_instances, stats.size());
+  EXPECT_EQ(14, stats[0].frames_);
+  EXPECT_EQ(2, stats[1].frames_);
+  EXPECT_EQ(0, stats[1].hits_ + stats[1].misses_);
+  EXPECT_EQ(num_instances * buffer_pool_size, bpm->GetPoolSize());
+
+  // Scenario: with 14 frames, 14 pages of instance 0 stay resident together.
+  for (page_id_t page_id = 0; page_id < 28; page_id += 2) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  uint64_t misses = bpm->GetInstanceStats()[0].misses_;
+  for (page_id_t page_id = 0; page_id < 28; page_id += 2) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(misses, bpm->GetInstanceStats()[0].misses_);
+
+  // Scenario: the statistics of the whole pool add up those of the instances.
+  BufferPoolStats total = bpm->GetStats();
+  EXPECT_EQ(num_instances * buffer_pool_size, total.frames_);
+  EXPECT_EQ(32, total.new_pages_);
+  EXPECT_EQ(misses, total.misses_);
+  EXPECT_EQ(16, total.resident_pages_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, BackgroundRebalanceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU,
+                                            false, true);
+  for (size_t i = 0; i < 32; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: only pages of instance 0 are used. The rebalancing thread moves frames over without any fetch waiting
+  // for a round.
+  for (int i = 0; i < 1000 && bpm->GetInstanceStats()[0].frames_ <= buffer_pool_size; ++i) {
+    for (page_id_t page_id = 0; page_id < 32; page_id += 2) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(buffer_pool_size, bpm->GetInstanceStats()[0].frames_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, NoFrameRebalancingTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Scenario: rebalancing is off by default, so the instances reserved no frames to grow into and keep their size
+  // however skewed the misses are, even when resumed.
+  bpm->SetFrameRebalancing(true);
+  for (size_t i = 0; i < 32; ++i) {
+    page_id_t page_id_temp;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  for (int round = 0; round < 4; ++round) {
+    for (page_id_t page_id = 0; page_id < 32; page_id += 2) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+    bpm->RebalanceFrames();
+  }
+  for (const auto &stats : bpm->GetInstanceStats()) {
+    EXPECT_EQ(buffer_pool_size, stats.frames_);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
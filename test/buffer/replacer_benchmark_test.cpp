@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// replacer_benchmark_test.cpp
+//
+// Identification: test/buffer/replacer_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+// Single-threaded microbenchmarks for the replacers. They are disabled by default because their numbers only mean
+// something on an otherwise idle machine; run them with
+//   ./test/replacer_benchmark_test --gtest_also_run_disabled_tests
+
+#include <chrono>  // NOLINT
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/intrusive_lru_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/**
+ * Drive a replacer the way the buffer pool does: a random frame is pinned and unpinned again, and every few
+ * operations a victim is taken and handed straight back.
+ * @return replacer operations per second
+ */
+auto RunReplacerWorkload(Replacer *replacer, size_t num_frames, int num_ops) -> double {
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<frame_id_t> frame_dist(0, static_cast<frame_id_t>(num_frames) - 1);
+  for (size_t i = 0; i < num_frames; i++) {
+    replacer->Unpin(static_cast<frame_id_t>(i));
+  }
+  int ops = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (ops < num_ops) {
+    frame_id_t frame_id = frame_dist(rng);
+    replacer->Pin(frame_id);
+    replacer->Unpin(frame_id);
+    ops += 2;
+    if (ops % 8 == 0 && replacer->Victim(&frame_id)) {
+      replacer->Unpin(frame_id);
+      ops += 2;
+    }
+  }
+  return ops / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// NOLINTNEXTLINE
+TEST(ReplacerBenchmarkTest, DISABLED_ReplacerOpsTest) {
+  const int num_ops = 10000000;
+
+  std::cout << std::setw(12) << "frames" << std::setw(16) << "LRU ops/sec" << std::setw(20) << "intrusive ops/sec"
+            << std::setw(18) << "clock ops/sec" << std::endl;
+  for (size_t num_frames : {64, 4096, 262144}) {
+    LRUReplacer lru_replacer(num_frames);
+    IntrusiveLRUReplacer intrusive_replacer(num_frames);
+    ClockReplacer clock_replacer(num_frames);
+    double lru_ops = RunReplacerWorkload(&lru_replacer, num_frames, num_ops);
+    double intrusive_ops = RunReplacerWorkload(&intrusive_replacer, num_frames, num_ops);
+    double clock_ops = RunReplacerWorkload(&clock_replacer, num_frames, num_ops);
+    std::cout << std::setw(12) << num_frames << std::setw(16) << std::fixed << std::setprecision(0) << lru_ops
+              << std::setw(20) << intrusive_ops << std::setw(18) << clock_ops << std::endl;
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,66 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c_test.cpp
+//
+// Identification: test/common/crc32c_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/** Bit-at-a-time CRC32C, straight from the definition. */
+static auto ReferenceCrc32c(const char *data, size_t length) -> uint32_t {
+  uint32_t crc = ~0U;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= static_cast<uint8_t>(data[i]);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0x82F63B78 : 0);
+    }
+  }
+  return ~crc;
+}
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, KnownValuesTest) {
+  const std::string digits = "123456789";
+  EXPECT_EQ(0xE3069283, Crc32c::Value(digits.data(), digits.size()));
+  const std::vector<char> zeros(32, 0);
+  EXPECT_EQ(0x8A9136AA, Crc32c::Value(zeros.data(), zeros.size()));
+  const std::vector<char> ones(32, static_cast<char>(0xff));
+  EXPECT_EQ(0x62A8AB43, Crc32c::Value(ones.data(), ones.size()));
+  EXPECT_EQ(0U, Crc32c::Value(nullptr, 0));
+}
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, RandomBuffersTest) {
+  std::mt19937 gen(15445);
+  std::vector<char> buffer(3 * 16384 + 7);
+  for (char &c : buffer) {
+    c = static_cast<char>(gen());
+  }
+  // Scenario: lengths around the stream block size and page sizes, at unaligned offsets, agree with the reference.
+  for (size_t length : {0, 1, 7, 8, 9, 100, 1359, 4079, 4080, 4081, 4095, 4096, 4097, 8192, 12241, 16384, 3 * 16384}) {
+    for (size_t offset : {0, 1, 3}) {
+      EXPECT_EQ(ReferenceCrc32c(buffer.data() + offset, length), Crc32c::Value(buffer.data() + offset, length))
+          << "length " << length << " offset " << offset;
+    }
+  }
+  // Scenario: extending the CRC of a prefix gives the CRC of the whole buffer.
+  uint32_t crc = Crc32c::Value(buffer.data(), 5000);
+  crc = Crc32c::Extend(crc, buffer.data() + 5000, 11000);
+  EXPECT_EQ(ReferenceCrc32c(buffer.data(), 16000), crc);
+}
+
+}  // namespace bustub
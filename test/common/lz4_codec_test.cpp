@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec_test.cpp
+//
+// Identification: test/common/lz4_codec_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz4_codec.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, BlockFormatTest) {
+  // Short inputs are a single sequence of literals: a token with the literal length in its high nibble, then the bytes.
+  const std::string abc = "abc";
+  std::vector<char> block(Lz4Codec::CompressBound(abc.size()));
+  ASSERT_EQ(4, Lz4Codec::Compress(abc.data(), block.data(), abc.size(), block.size()));
+  EXPECT_EQ(std::string("\x30"
+                        "abc"),
+            std::string(block.data(), 4));
+
+  // A run of one byte is a literal and an overlapping match at offset 1.
+  const std::string run(64, 'z');
+  ASSERT_GT(Lz4Codec::Compress(run.data(), block.data(), run.size(), block.size()), 0);
+  const char run_block[] = {0x1f, 'z', 0x01, 0x00, 0x27, 0x50, 'z', 'z', 'z', 'z', 'z'};
+  std::vector<char> out(run.size());
+  EXPECT_EQ(64, Lz4Codec::Decompress(run_block, out.data(), sizeof(run_block), out.size()));
+  EXPECT_EQ(run, std::string(out.data(), out.size()));
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, RoundTripTest) {
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::uniform_int_distribution<int> word_dist(0, 7);
+  const int size = 16384;
+  std::vector<std::vector<char>> inputs(3, std::vector<char>(size));
+  // mostly zeros, random bytes, and text made of a few words
+  inputs[0][100] = 1;
+  for (char &c : inputs[1]) {
+    c = static_cast<char>(byte_dist(gen));
+  }
+  const std::vector<std::string> words = {"select ", "from ", "where ", "bustub ", "page ", "tuple ", "42 ", "and "};
+  for (size_t i = 0; i < inputs[2].size();) {
+    for (char c : words[word_dist(gen)]) {
+      if (i < inputs[2].size()) {
+        inputs[2][i++] = c;
+      }
+    }
+  }
+
+  for (const auto &input : inputs) {
+    std::vector<char> block(Lz4Codec::CompressBound(size));
+    int block_size = Lz4Codec::Compress(input.data(), block.data(), size, block.size());
+    ASSERT_GT(block_size, 0);
+    std::vector<char> output(size);
+    ASSERT_EQ(size, Lz4Codec::Decompress(block.data(), output.data(), block_size, size));
+    EXPECT_EQ(input, output);
+  }
+  // A block that does not fit is not written.
+  std::vector<char> small_block(size / 2);
+  EXPECT_EQ(0, Lz4Codec::Compress(inputs[1].data(), small_block.data(), size, small_block.size()));
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, MalformedBlockTest) {
+  std::vector<char> output(64);
+  // Literals running past the end of the block, a match before the start of the output, and an empty block.
+  const char long_literals[] = {0x50, 'a', 'b'};
+  EXPECT_LT(Lz4Codec::Decompress(long_literals, output.data(), sizeof(long_literals), output.size()), 0);
+  const char bad_offset[] = {0x10, 'a', 0x05, 0x00, 0x00};
+  EXPECT_LT(Lz4Codec::Decompress(bad_offset, output.data(), sizeof(bad_offset), output.size()), 0);
+  EXPECT_LT(Lz4Codec::Decompress(nullptr, output.data(), 0, output.size()), 0);
+  // A block that decompresses to more than the capacity.
+  const char run_block[] = {0x1f, 'z', 0x01, 0x00, 0x27, 0x50, 'z', 'z', 'z', 'z', 'z'};
+  EXPECT_LT(Lz4Codec::Decompress(run_block, output.data(), sizeof(run_block), 16), 0);
+}
+
+}  // namespace bustub
@@ -0,0 +1,380 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_table_benchmark_test.cpp
+//
+// Identification: test/container/hash_table_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+// Benchmarks for the extendible hash table. They are disabled by default because their numbers only mean something
+// on an otherwise idle machine; run them with
+//   ./test/hash_table_benchmark_test --gtest_also_run_disabled_tests
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "container/hash/extendible_hash_table.h"
+#include "gtest/gtest.h"
+#include "murmur3/MurmurHash3.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/hash_table_bucket_page.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+/** A disk manager that forgets deleted pages, i.e. one whose file only ever grows. */
+class NoReuseDiskManager : public DiskManager {
+ public:
+  using DiskManager::DiskManager;
+
+  auto DeallocatePage(page_id_t page_id) -> bool override { return IsAllocatedPage(page_id); }
+};
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_ChurnTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 32;
+  const int num_rounds = 20;
+  const int keys_per_round = 20000;
+
+  // Every round fills the table with new keys, looks all of them up and deletes them again. Bucket pages emptied by
+  // the deletes are merged away, and the next round splits into new ones.
+  std::cout << std::setw(8) << "reuse" << std::setw(8) << "round" << std::setw(12) << "file KiB" << std::setw(12)
+            << "free pages" << std::setw(16) << "lookups/sec" << std::endl;
+  for (bool reuse : {false, true}) {
+    DiskManager *disk_manager = reuse ? new DiskManager(db_name) : new NoReuseDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+    auto *ht = new ExtendibleHashTable<int, int, IntComparator>("churn", bpm, IntComparator(), HashFunction<int>());
+
+    for (int round = 0; round < num_rounds; round++) {
+      int first_key = round * keys_per_round;
+      for (int key = first_key; key < first_key + keys_per_round; key++) {
+        ASSERT_TRUE(ht->Insert(nullptr, key, key));
+      }
+      bpm->FlushAllPages();
+      auto start = std::chrono::steady_clock::now();
+      std::vector<int> result;
+      for (int key = first_key; key < first_key + keys_per_round; key++) {
+        result.clear();
+        ASSERT_TRUE(ht->GetValue(nullptr, key, &result));
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      for (int key = first_key; key < first_key + keys_per_round; key++) {
+        ASSERT_TRUE(ht->Remove(nullptr, key, key));
+      }
+      bpm->FlushAllPages();
+
+      struct stat stat_buf;
+      ASSERT_EQ(0, stat(db_name.c_str(), &stat_buf));
+      if (round % 4 == 3) {
+        std::cout << std::setw(8) << (reuse ? "on" : "off") << std::setw(8) << round + 1 << std::setw(12)
+                  << stat_buf.st_size / 1024 << std::setw(12) << disk_manager->GetNumFreePages() << std::setw(16)
+                  << std::fixed << std::setprecision(0) << keys_per_round / seconds << std::endl;
+      }
+    }
+
+    uint64_t released = disk_manager->CompactFile();
+    struct stat stat_buf;
+    ASSERT_EQ(0, stat(db_name.c_str(), &stat_buf));
+    std::cout << std::setw(8) << (reuse ? "on" : "off") << " after CompactFile: " << stat_buf.st_size / 1024
+              << " KiB file, " << released / 1024 << " KiB released" << std::endl;
+
+    delete ht;
+    delete bpm;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    remove(db_name.c_str());
+    remove("bench.log");
+    remove("bench.fsm");
+    remove("bench.crc");
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_ConcurrentInsertLookupTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 256;
+  const int num_stable_keys = 20000;
+  // Well below what the default header depth holds, so that no insert fails.
+  const int num_inserts = 100000;
+
+  // Half the threads insert new keys, which split buckets all the time, while the other half look up keys that were
+  // there from the start. Every thread count starts from a fresh table.
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "inserts/sec" << std::setw(16) << "lookups/sec"
+            << std::endl;
+  for (int num_threads : {2, 4, 8, 16}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+    auto *ht = new ExtendibleHashTable<int, int, IntComparator>("bench", bpm, IntComparator(), HashFunction<int>());
+    for (int key = -num_stable_keys; key < 0; key++) {
+      ASSERT_TRUE(ht->Insert(nullptr, key, key));
+    }
+
+    int num_inserters = num_threads / 2;
+    int keys_per_inserter = num_inserts / num_inserters;
+    std::atomic<int> inserters_running = num_inserters;
+    std::atomic<uint64_t> num_lookups = 0;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < num_threads; tid++) {
+      if (tid < num_inserters) {
+        threads.emplace_back([&, tid] {
+          for (int key = tid * keys_per_inserter; key < (tid + 1) * keys_per_inserter; key++) {
+            ht->Insert(nullptr, key, key);
+          }
+          inserters_running--;
+        });
+      } else {
+        threads.emplace_back([&, tid] {
+          std::vector<int> result;
+          uint64_t lookups = 0;
+          for (int i = tid; inserters_running > 0; i += 7) {
+            result.clear();
+            ht->GetValue(nullptr, -1 - i % num_stable_keys, &result);
+            lookups++;
+          }
+          num_lookups += lookups;
+        });
+      }
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::setw(8) << num_threads << std::setw(16) << std::fixed << std::setprecision(0)
+              << num_inserts / seconds << std::setw(16) << num_lookups / seconds << std::endl;
+
+    delete ht;
+    delete bpm;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    remove(db_name.c_str());
+    remove("bench.log");
+    remove("bench.fsm");
+    remove("bench.crc");
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_BatchLookupTest) {
+  const std::string db_name = "bench.db";
+  const int num_keys = 50000;
+  const int num_lookups = 200000;
+
+  // Random keys, present and missing, are looked up one at a time with GetValue and in batches with GetValues. A
+  // pool of 256 frames holds every bucket; one of 32 frames has to read most buckets back from disk.
+  std::cout << std::setw(8) << "frames" << std::setw(8) << "batch" << std::setw(16) << "keys/sec" << std::endl;
+  for (size_t buffer_pool_size : {256, 32}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+    auto *ht = new ExtendibleHashTable<int, int, IntComparator>("bench", bpm, IntComparator(), HashFunction<int>());
+    for (int key = 0; key < num_keys; key++) {
+      ASSERT_TRUE(ht->Insert(nullptr, key, key));
+    }
+    std::vector<int> keys(num_lookups);
+    uint32_t seed = 42;
+    for (auto &key : keys) {
+      seed = seed * 1103515245 + 12345;
+      key = static_cast<int>(seed >> 8) % (2 * num_keys);
+    }
+
+    for (size_t batch_size : {1, 16, 128, 1024}) {
+      size_t num_found = 0;
+      auto start = std::chrono::steady_clock::now();
+      if (batch_size == 1) {
+        std::vector<int> result;
+        for (int key : keys) {
+          result.clear();
+          num_found += ht->GetValue(nullptr, key, &result) ? 1 : 0;
+        }
+      } else {
+        std::vector<std::vector<int>> results;
+        for (size_t begin = 0; begin < keys.size(); begin += batch_size) {
+          std::vector<int> batch(keys.begin() + begin, keys.begin() + std::min(begin + batch_size, keys.size()));
+          num_found += ht->GetValues(nullptr, batch, &results);
+        }
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_LT(num_lookups / 3, num_found);
+      std::cout << std::setw(8) << buffer_pool_size << std::setw(8) << batch_size << std::setw(16) << std::fixed
+                << std::setprecision(0) << num_lookups / seconds << std::endl;
+    }
+
+    delete ht;
+    delete bpm;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    remove(db_name.c_str());
+    remove("bench.log");
+    remove("bench.fsm");
+    remove("bench.crc");
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_DirectoryReadTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 256;
+  const int num_keys = 50000;
+  const int lookups_per_thread = 200000;
+
+  // Lookups only, so that the header and directories are all the threads share. With optimistic reads off, every
+  // lookup read latches the header and its directory page; with them on, lookups read the in-memory mirror.
+  std::cout << std::setw(12) << "optimistic" << std::setw(8) << "threads" << std::setw(16) << "lookups/sec"
+            << std::endl;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("bench", bpm, IntComparator(), HashFunction<int>());
+  for (int key = 0; key < num_keys; key++) {
+    ASSERT_TRUE(ht->Insert(nullptr, key, key));
+  }
+  for (bool optimistic : {false, true}) {
+    ht->SetOptimisticReads(optimistic);
+    for (int num_threads : {1, 2, 4, 8}) {
+      std::vector<std::thread> threads;
+      auto start = std::chrono::steady_clock::now();
+      for (int tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back([&, tid] {
+          std::vector<int> result;
+          for (int i = 0; i < lookups_per_thread; i++) {
+            result.clear();
+            ht->GetValue(nullptr, (tid + i * 7) % num_keys, &result);
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << std::setw(12) << (optimistic ? "on" : "off") << std::setw(8) << num_threads << std::setw(16)
+                << std::fixed << std::setprecision(0) << num_threads * lookups_per_thread / seconds << std::endl;
+    }
+  }
+
+  delete ht;
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bench.log");
+  remove("bench.fsm");
+  remove("bench.crc");
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_ScaleTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 16384;
+  // Scaled down from the hundreds of millions a full header holds, so that the run fits a small machine.
+  const int num_keys = 8 << 20;
+  const int report_every = 1 << 20;
+
+  // A single thread inserts keys into a table with the deepest header, and reports the insert rate of every step
+  // while the directories grow, then the lookup rate of the full table.
+  std::cout << "header depth " << HEADER_MAX_DEPTH << ", " << (1 << HEADER_MAX_DEPTH) << " directories of "
+            << DIRECTORY_ARRAY_SIZE << " buckets" << std::endl;
+  std::cout << std::setw(12) << "keys" << std::setw(14) << "max depth" << std::setw(16) << "inserts/sec" << std::endl;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("bench", bpm, IntComparator(), HashFunction<int>(),
+                                                               HEADER_MAX_DEPTH);
+  auto start = std::chrono::steady_clock::now();
+  for (int key = 0; key < num_keys; key++) {
+    ASSERT_TRUE(ht->Insert(nullptr, key, key)) << key;
+    if ((key + 1) % report_every == 0) {
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << std::setw(12) << key + 1 << std::setw(14) << ht->GetGlobalDepth() << std::setw(16) << std::fixed
+                << std::setprecision(0) << report_every / seconds << std::endl;
+      start = std::chrono::steady_clock::now();
+    }
+  }
+
+  start = std::chrono::steady_clock::now();
+  std::vector<int> result;
+  for (int i = 0; i < num_keys; i++) {
+    result.clear();
+    int key = static_cast<int>((i * 7LL) % num_keys);
+    ASSERT_TRUE(ht->GetValue(nullptr, key, &result)) << key;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "lookups/sec " << std::fixed << std::setprecision(0) << num_keys / seconds << std::endl;
+
+  delete ht;
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bench.log");
+  remove("bench.fsm");
+  remove("bench.crc");
+}
+
+/**
+ * Fill one bucket page with keys of the given size and time lookups of keys that are there and of keys that are not.
+ * A full bucket is what a lookup scans in the worst case, right before the bucket splits.
+ */
+template <size_t KeySize>
+void BenchmarkBucketLookups(const std::string &key_column, int num_lookups) {
+  using BucketPage = HashTableBucketPage<GenericKey<KeySize>, RID, GenericComparator<KeySize>>;
+  auto key_schema = ParseCreateStatement(key_column);
+  GenericComparator<KeySize> comparator(key_schema.get());
+  auto make_key = [](int32_t key) {
+    GenericKey<KeySize> index_key;
+    memset(index_key.data_, 0, KeySize);
+    memcpy(index_key.data_, &key, sizeof(key));
+    return index_key;
+  };
+
+  auto *data = new char[PAGE_SIZE]();
+  auto *bucket_page = reinterpret_cast<BucketPage *>(data);
+  int num_keys = 0;
+  for (; !bucket_page->IsFull(); num_keys++) {
+    ASSERT_TRUE(bucket_page->Insert(make_key(num_keys * 7), RID(num_keys, 0), comparator));
+  }
+
+  double ns_per_lookup[2];
+  for (bool hit : {true, false}) {
+    std::vector<RID> result;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_lookups; i++) {
+      result.clear();
+      int key = (i % num_keys) * 7 + (hit ? 0 : 1);
+      ASSERT_EQ(hit, bucket_page->GetValue(make_key(key), comparator, &result));
+    }
+    ns_per_lookup[hit ? 0 : 1] =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / num_lookups;
+  }
+  std::cout << std::setw(10) << KeySize << std::setw(8) << num_keys << std::setw(12) << std::fixed
+            << std::setprecision(1) << ns_per_lookup[0] << std::setw(12) << ns_per_lookup[1] << std::endl;
+  delete[] data;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableBenchmarkTest, DISABLED_BucketLookupTest) {
+  const int num_lookups = 100000;
+
+  std::cout << "fingerprints " << (BUSTUB_HASH_FINGERPRINTS ? "on" : "off") << std::endl;
+  std::cout << std::setw(10) << "key bytes" << std::setw(8) << "slots" << std::setw(12) << "hit ns" << std::setw(12)
+            << "miss ns" << std::endl;
+  BenchmarkBucketLookups<4>("a integer", num_lookups);
+  BenchmarkBucketLookups<8>("a integer", num_lookups);
+  BenchmarkBucketLookups<16>("a integer", num_lookups);
+  BenchmarkBucketLookups<32>("a integer", num_lookups);
+  BenchmarkBucketLookups<64>("a integer", num_lookups);
+}
+
+}  // namespace bustub
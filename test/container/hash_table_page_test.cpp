@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -132,4 +133,59 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageFullTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+      bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+
+  // Scenario: the bucket fills up to the last slot, and a full bucket rejects further inserts.
+  int capacity = 0;
+  for (; !bucket_page->IsFull(); capacity++) {
+    ASSERT_TRUE(bucket_page->Insert(capacity / 4, capacity, IntComparator())) << capacity;
+  }
+  EXPECT_LT(400, capacity);
+  EXPECT_FALSE(bucket_page->Insert(capacity, capacity, IntComparator()));
+
+  // Scenario: every key has several values, all of which are found, and keys that were never inserted are not.
+  for (int key = 0; key < capacity / 4; key++) {
+    std::vector<int> res;
+    ASSERT_TRUE(bucket_page->GetValue(key, IntComparator(), &res));
+    std::vector<int> expected{4 * key, 4 * key + 1, 4 * key + 2, 4 * key + 3};
+    EXPECT_EQ(expected, res);
+    EXPECT_FALSE(bucket_page->Insert(key, 4 * key + 3, IntComparator()));
+  }
+  for (int key = capacity; key < capacity + 1000; key++) {
+    std::vector<int> res;
+    EXPECT_FALSE(bucket_page->GetValue(key, IntComparator(), &res));
+  }
+
+  // Scenario: tombstones left by removes are reused, and removed pairs stay gone.
+  for (int i = 0; i < capacity; i += 3) {
+    ASSERT_TRUE(bucket_page->Remove(i / 4, i, IntComparator()));
+    EXPECT_FALSE(bucket_page->Remove(i / 4, i, IntComparator()));
+  }
+  EXPECT_FALSE(bucket_page->IsFull());
+  for (int i = 0; i < capacity; i += 3) {
+    std::vector<int> res;
+    bucket_page->GetValue(i / 4, IntComparator(), &res);
+    EXPECT_EQ(res.end(), std::find(res.begin(), res.end(), i));
+    ASSERT_TRUE(bucket_page->Insert(-1 - i, i, IntComparator()));
+  }
+  EXPECT_TRUE(bucket_page->IsFull());
+  for (int i = 0; i < capacity; i += 3) {
+    std::vector<int> res;
+    ASSERT_TRUE(bucket_page->GetValue(-1 - i, IntComparator(), &res));
+    EXPECT_EQ(std::vector<int>{i}, res);
+  }
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
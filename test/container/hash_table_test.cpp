@@ -10,6 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -18,6 +21,8 @@
 #include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "murmur3/MurmurHash3.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
 
 namespace bustub {
 
@@ -27,14 +32,14 @@ namespace bustub {
 TEST(HashTableTest, SampleTest) {
   auto *disk_manager = new DiskManager("test.db");
   auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
-  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), HashFunction<int>());
 
   // insert a few values
   for (int i = 0; i < 5000; i++) {
-    EXPECT_EQ(true, ht.Insert(nullptr, i, i));
-    //LOG_DEBUG("i: %4d, page size: %3d", i, ht.GetGlobalDepth());
+    EXPECT_EQ(true, ht->Insert(nullptr, i, i));
+    //LOG_DEBUG("i: %4d, page size: %3d", i, ht->GetGlobalDepth());
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     auto size = res.size();
     if(size!=1)
       std::cout<< "Failed to insert " << i << std::endl;
@@ -43,31 +48,31 @@ TEST(HashTableTest, SampleTest) {
   }
 
   std::cout<<"verified insert"<<std::endl;
-  ht.VerifyIntegrity();
+  ht->VerifyIntegrity();
 
   // check if the inserted values are all there
   for (int i = 0; i < 5000; i++) {
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     EXPECT_EQ(1, res.size()) << "Failed to keep " << i << std::endl;
     EXPECT_EQ(i, res[0]);
   }
 
 
   std::cout<<"verified keep"<<std::endl;
-  ht.VerifyIntegrity();
+  ht->VerifyIntegrity();
 
   // insert one more value for each key
   for (int i = 0; i < 5000; i++) {
     if (i == 0) {
       // duplicate values for the same key are not allowed
-      EXPECT_FALSE(ht.Insert(nullptr, i, 2 * i));
+      EXPECT_FALSE(ht->Insert(nullptr, i, 2 * i));
     } else {
-      EXPECT_TRUE(ht.Insert(nullptr, i, 2 * i));
+      EXPECT_TRUE(ht->Insert(nullptr, i, 2 * i));
     }
-    ht.Insert(nullptr, i, 2 * i);
+    ht->Insert(nullptr, i, 2 * i);
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     if (i == 0) {
       // duplicate values for the same key are not allowed
       EXPECT_EQ(1, res.size());
@@ -83,18 +88,18 @@ TEST(HashTableTest, SampleTest) {
     }
   }
 
-  ht.VerifyIntegrity();
+  ht->VerifyIntegrity();
   std::cout<<"verified insert more "<<std::endl;
   // look for a key that does not exist
   std::vector<int> res;
-  ht.GetValue(nullptr, 114514, &res);
+  ht->GetValue(nullptr, 114514, &res);
   EXPECT_EQ(0, res.size());
 
   // delete some values
   for (int i = 0; i < 5000; i++) {
-    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_TRUE(ht->Remove(nullptr, i, i));
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     if (i == 0) {
       // (0, 0) is the only pair with key 0
       EXPECT_EQ(0, res.size());
@@ -104,22 +109,263 @@ TEST(HashTableTest, SampleTest) {
     }
   }
 
-  ht.VerifyIntegrity();
+  ht->VerifyIntegrity();
 
   // delete all values
   for (int i = 0; i < 5000; i++) {
     if (i == 0) {
       // (0, 0) has been deleted
-      EXPECT_FALSE(ht.Remove(nullptr, i, 2 * i));
+      EXPECT_FALSE(ht->Remove(nullptr, i, 2 * i));
     } else {
-      EXPECT_TRUE(ht.Remove(nullptr, i, 2 * i));
+      EXPECT_TRUE(ht->Remove(nullptr, i, 2 * i));
     }
   }
 
-  ht.VerifyIntegrity();
+  ht->VerifyIntegrity();
 
+  delete ht;
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, GetValuesTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // Even keys have two values, odd keys one.
+  for (int key = 0; key < 5000; key++) {
+    ASSERT_TRUE(ht->Insert(nullptr, key, key));
+    if (key % 2 == 0) {
+      ASSERT_TRUE(ht->Insert(nullptr, key, key + 5000));
+    }
+  }
+
+  // Scenario: a batch with missing and repeated keys gets the same values as one lookup per key, in key order.
+  std::vector<int> keys;
+  for (int i = 0; i < 3000; i++) {
+    keys.push_back(i * 7 % 6000);
+  }
+  std::vector<std::vector<int>> results;
+  size_t num_found = ht->GetValues(nullptr, keys, &results);
+  ASSERT_EQ(keys.size(), results.size());
+  size_t expected_found = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<int> expected;
+    expected_found += ht->GetValue(nullptr, keys[i], &expected) ? 1 : 0;
+    std::sort(expected.begin(), expected.end());
+    std::sort(results[i].begin(), results[i].end());
+    EXPECT_EQ(expected, results[i]) << keys[i];
+    EXPECT_EQ(keys[i] < 5000 ? (keys[i] % 2 == 0 ? 2 : 1) : 0, results[i].size()) << keys[i];
+  }
+  EXPECT_EQ(expected_found, num_found);
+
+  // Scenario: an empty batch finds nothing.
+  EXPECT_EQ(0, ht->GetValues(nullptr, {}, &results));
+  EXPECT_TRUE(results.empty());
+
+  delete ht;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, DirectoryMirrorTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), HashFunction<int>());
+  for (int key = 0; key < 2000; key++) {
+    ASSERT_TRUE(ht->Insert(nullptr, key, key));
+  }
+
+  // Scenario: the header stays pinned and a lookup that reads the directory mirror fetches its bucket page and
+  // nothing else; one that latches the directory fetches the directory page as well.
+  for (bool optimistic : {true, false}) {
+    ht->SetOptimisticReads(optimistic);
+    uint64_t fetches = bpm->GetStats().hits_ + bpm->GetStats().misses_;
+    for (int key = 0; key < 2000; key++) {
+      std::vector<int> res;
+      ASSERT_TRUE(ht->GetValue(nullptr, key, &res));
+      EXPECT_EQ(key, res[0]);
+    }
+    EXPECT_EQ(fetches + (optimistic ? 2000 : 4000), bpm->GetStats().hits_ + bpm->GetStats().misses_);
+  }
+
+  // Scenario: with optimistic reads off, removes still find their buckets, and merges keep the directory consistent.
+  for (int key = 0; key < 2000; key++) {
+    ASSERT_TRUE(ht->Remove(nullptr, key, key));
+  }
+  ht->VerifyIntegrity();
+  for (int key = 0; key < 2000; key++) {
+    std::vector<int> res;
+    EXPECT_FALSE(ht->GetValue(nullptr, key, &res));
+  }
+
+  delete ht;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, MultiDirectoryTest) {
+  // Large keys, so that a directory fills up after a few thousand of them.
+  using Table = ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema.get());
+  auto make_key = [](int64_t key) {
+    GenericKey<64> index_key;
+    memset(index_key.data_, 0, sizeof(index_key.data_));
+    memcpy(index_key.data_, &key, sizeof(key));
+    return index_key;
+  };
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+
+  // Scenario: with a single directory, inserts fail once a bucket is full and the directory cannot double.
+  auto *single = new Table("single", bpm, comparator, HashFunction<GenericKey<64>>(), 0);
+  int64_t capacity = 0;
+  while (single->Insert(nullptr, make_key(capacity), RID(capacity))) {
+    capacity++;
+  }
+  EXPECT_EQ(static_cast<uint32_t>(__builtin_ctz(DIRECTORY_ARRAY_SIZE)), single->GetGlobalDepth());
+  single->VerifyIntegrity();
+
+  // Scenario: a header with four directories takes twice as many keys and finds all of them, one by one and in
+  // batches.
+  auto *multi = new Table("multi", bpm, comparator, HashFunction<GenericKey<64>>(), 2);
+  std::vector<GenericKey<64>> keys;
+  for (int64_t key = 0; key < 2 * capacity; key++) {
+    keys.push_back(make_key(key));
+    ASSERT_TRUE(multi->Insert(nullptr, keys.back(), RID(key))) << key;
+  }
+  multi->VerifyIntegrity();
+  for (int64_t key = 0; key < 2 * capacity; key++) {
+    std::vector<RID> res;
+    ASSERT_TRUE(multi->GetValue(nullptr, keys[key], &res)) << key;
+    EXPECT_EQ(RID(key), res[0]);
+  }
+  std::vector<std::vector<RID>> results;
+  EXPECT_EQ(keys.size(), multi->GetValues(nullptr, keys, &results));
+
+  // Scenario: removing every key merges buckets within each directory and leaves nothing to find.
+  for (int64_t key = 0; key < 2 * capacity; key++) {
+    ASSERT_TRUE(multi->Remove(nullptr, keys[key], RID(key))) << key;
+  }
+  multi->VerifyIntegrity();
+  EXPECT_EQ(0, multi->GetValues(nullptr, keys, &results));
+
+  delete multi;
+  delete single;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, DestructorTest) {
+  const size_t buffer_pool_size = 4;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: every table pins its header page while it lives, and releases it when it is destroyed.
+  for (int i = 0; i < 3 * static_cast<int>(buffer_pool_size); i++) {
+    auto *ht = new ExtendibleHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), HashFunction<int>());
+    ASSERT_TRUE(ht->Insert(nullptr, i, i));
+    delete ht;
+  }
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (page_id_t &page_id : page_ids) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, ConcurrentInsertRemoveTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), HashFunction<int>());
+  const int num_threads = 4;
+  const int keys_per_thread = 5000;
+  const int num_stable_keys = 1000;
+
+  // Keys below 0 stay in the table while the others are inserted and removed, and must be found all the time.
+  for (int key = -num_stable_keys; key < 0; key++) {
+    ASSERT_TRUE(ht->Insert(nullptr, key, key));
+  }
+  std::atomic<bool> done = false;
+  std::thread reader([&] {
+    while (!done) {
+      for (int key = -num_stable_keys; key < 0; key++) {
+        std::vector<int> res;
+        ASSERT_TRUE(ht->GetValue(nullptr, key, &res)) << key;
+        ASSERT_EQ(1, res.size());
+        ASSERT_EQ(key, res[0]);
+      }
+    }
+  });
+
+  // Scenario: concurrent inserts split buckets, and every key is found afterwards.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int key = tid * keys_per_thread; key < (tid + 1) * keys_per_thread; key++) {
+        EXPECT_TRUE(ht->Insert(nullptr, key, key));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ht->VerifyIntegrity();
+  for (int key = 0; key < num_threads * keys_per_thread; key++) {
+    std::vector<int> res;
+    ht->GetValue(nullptr, key, &res);
+    ASSERT_EQ(1, res.size()) << key;
+    EXPECT_EQ(key, res[0]);
+  }
+
+  // Scenario: concurrent removes merge buckets, and no key is left behind.
+  threads.clear();
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int key = tid * keys_per_thread; key < (tid + 1) * keys_per_thread; key++) {
+        EXPECT_TRUE(ht->Remove(nullptr, key, key));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  done = true;
+  reader.join();
+  ht->VerifyIntegrity();
+  for (int key = 0; key < num_threads * keys_per_thread; key++) {
+    std::vector<int> res;
+    EXPECT_FALSE(ht->GetValue(nullptr, key, &res)) << key;
+  }
+
+  delete ht;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
   delete disk_manager;
   delete bpm;
 }
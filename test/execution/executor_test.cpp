@@ -23,6 +23,7 @@
 #include "execution/executor_context.h"
 #include "execution/executors/aggregation_executor.h"
 #include "execution/executors/insert_executor.h"
+#include "execution/executors/nested_index_join_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
 #include "execution/expressions/aggregate_value_expression.h"
 #include "execution/expressions/column_value_expression.h"
@@ -32,6 +33,7 @@
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
 #include "executor_test_util.h"  // NOLINT
@@ -507,6 +509,57 @@ TEST_F(ExecutorTest, SimpleHashJoinTest) {
   }
 }
 
+// SELECT outer.colA, outer.colB, inner.colA, inner.colC FROM test_1 outer JOIN test_1 inner ON outer.colB = inner.colA;
+TEST_F(ExecutorTest, SimpleNestedIndexJoinTest) {
+  auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("a integer");
+  GetExecutorContext()->GetCatalog()->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index1", "test_1", schema, *key_schema, {0}, 8, HashFunctionType{});
+
+  // Construct sequential scan of the outer table
+  const Schema *outer_schema{};
+  std::unique_ptr<AbstractPlanNode> scan_plan{};
+  {
+    auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+    auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+    outer_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+    scan_plan = std::make_unique<SeqScanPlanNode>(outer_schema, nullptr, table_info->oid_);
+  }
+
+  // Construct the join plan; the inner tuples are read from the table, so their columns refer to the table schema
+  const Schema *out_schema{};
+  std::unique_ptr<NestedIndexJoinPlanNode> join_plan{};
+  {
+    auto *outer_col_a = MakeColumnValueExpression(*outer_schema, 0, "colA");
+    auto *outer_col_b = MakeColumnValueExpression(*outer_schema, 0, "colB");
+    auto *inner_col_a = MakeColumnValueExpression(schema, 1, "colA");
+    auto *inner_col_c = MakeColumnValueExpression(schema, 1, "colC");
+    auto *predicate = MakeComparisonExpression(outer_col_b, inner_col_a, ComparisonType::Equal);
+    out_schema = MakeOutputSchema({{"outer_colA", outer_col_a},
+                                   {"outer_colB", outer_col_b},
+                                   {"inner_colA", inner_col_a},
+                                   {"inner_colC", inner_col_c}});
+    join_plan = std::make_unique<NestedIndexJoinPlanNode>(
+        out_schema, std::vector<const AbstractPlanNode *>{scan_plan.get()}, predicate, table_info->oid_, "index1",
+        outer_schema, &schema);
+  }
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(join_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+
+  // colB is in [0, 10) and colA is unique, so every outer tuple matches exactly one inner tuple, across several batches
+  ASSERT_GT(TEST1_SIZE, 2 * NestIndexJoinExecutor::BATCH_SIZE);
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+  for (size_t i = 0; i < result_set.size(); i++) {
+    const auto &tuple = result_set[i];
+    ASSERT_EQ(tuple.GetValue(out_schema, out_schema->GetColIdx("outer_colA")).GetAs<int32_t>(), i);
+    const auto outer_col_b = tuple.GetValue(out_schema, out_schema->GetColIdx("outer_colB")).GetAs<int32_t>();
+    const auto inner_col_a = tuple.GetValue(out_schema, out_schema->GetColIdx("inner_colA")).GetAs<int32_t>();
+    ASSERT_EQ(outer_col_b, inner_col_a);
+  }
+}
+
 // SELECT COUNT(col_a), SUM(col_a), min(col_a), max(col_a) from test_1;
 TEST_F(ExecutorTest, SimpleAggregationTest) {
   const Schema *scan_schema;
@@ -0,0 +1,202 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager_test.cpp
+//
+// Identification: test/storage/compressed_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/disk/compressed_disk_manager.h"
+
+namespace bustub {
+
+class CompressedDiskManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  };
+};
+
+/** Fill a page with a few tuple-like records and leave the rest empty, like a half-full table page. */
+static void FillCompressiblePage(char *data, int seed) {
+  std::memset(data, 0, PAGE_SIZE);
+  for (int i = 0; i < 32; i++) {
+    std::snprintf(data + i * 64, 64, "tuple %d of page %d", i, seed);
+  }
+}
+
+static void FillRandomPage(char *data, std::mt19937 *rng) {
+  for (size_t i = 0; i < PAGE_SIZE; i++) {
+    data[i] = static_cast<char>((*rng)());
+  }
+}
+
+static auto GetFileSize(const std::string &file_name) -> int64_t {
+  struct stat stat_buf;
+  return stat(file_name.c_str(), &stat_buf) == 0 ? stat_buf.st_size : -1;
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ReadWritePageTest) {
+  char buf[PAGE_SIZE];
+  char data[PAGE_SIZE];
+  std::mt19937 rng(15445);
+  CompressedDiskManager dm("test.db");
+
+  // Never written pages read as zeros.
+  std::memset(buf, 1, PAGE_SIZE);
+  dm.ReadPage(3, buf);
+  for (char c : buf) {
+    ASSERT_EQ(c, 0);
+  }
+
+  FillCompressiblePage(data, 0);
+  dm.WritePage(0, data);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+
+  // Incompressible pages are stored as is.
+  FillRandomPage(data, &rng);
+  dm.WritePage(5, data);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+
+  // Overwrite with data of another compressed size, in both directions.
+  dm.WritePage(0, data);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+  FillCompressiblePage(data, 5);
+  dm.WritePage(5, data);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+
+  EXPECT_EQ(dm.GetNumWrites(), 4);
+  EXPECT_EQ(dm.GetNumReads(), 5);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ReopenTest) {
+  const int num_pages = 64;
+  char buf[PAGE_SIZE];
+  char data[PAGE_SIZE];
+  {
+    CompressedDiskManager dm("test.db");
+    for (int round = 0; round < 3; round++) {
+      for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+        FillCompressiblePage(data, page_id * 10 + round);
+        dm.WritePage(page_id, data);
+      }
+    }
+    dm.ShutDown();
+  }
+
+  // The extent map is rebuilt from the file, and the latest version of every page wins.
+  CompressedDiskManager dm("test.db");
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    FillCompressiblePage(data, page_id * 10 + 2);
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+  }
+
+  // Space of the old versions is reused instead of growing the file.
+  int64_t file_size = GetFileSize("test.db");
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    FillCompressiblePage(data, page_id * 10 + 3);
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_EQ(GetFileSize("test.db"), file_size);
+  EXPECT_LT(file_size, static_cast<int64_t>(num_pages) * PAGE_SIZE);
+  EXPECT_LE(dm.GetStoredBytes(), static_cast<uint64_t>(file_size));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ChecksumTest) {
+  std::mt19937 rng(15445);
+  char buf[PAGE_SIZE];
+  char data[PAGE_SIZE];
+  {
+    CompressedDiskManager dm("test.db");
+    FillRandomPage(data, &rng);
+    dm.WritePage(0, data);
+    dm.ShutDown();
+  }
+
+  // A random page is stored uncompressed in the first extent; damage a byte of it.
+  int fd = open("test.db", O_RDWR);
+  ASSERT_NE(-1, fd);
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, CompressedDiskManager::SECTOR_SIZE));
+  byte ^= 0x01;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, CompressedDiskManager::SECTOR_SIZE));
+  close(fd);
+
+  CompressedDiskManager dm("test.db");
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  EXPECT_EQ((std::vector<page_id_t>{0}), dm.GetCorruptPages());
+
+  // Scenario: a repaired page is written back as a new record.
+  dm.SetPageRepairHandler([&](page_id_t page_id, char *page_data) {
+    std::memcpy(page_data, data, PAGE_SIZE);
+    return true;
+  });
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  EXPECT_EQ(2, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ConcurrentReadWriteTest) {
+  const int num_threads = 4;
+  const int num_pages = 16;
+  CompressedDiskManager dm("test.db");
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&dm, tid] {
+      char buf[PAGE_SIZE];
+      char data[PAGE_SIZE];
+      for (int round = 0; round < 50; round++) {
+        for (page_id_t page_id = tid; page_id < num_pages; page_id += num_threads) {
+          FillCompressiblePage(data, page_id * 100 + round);
+          dm.WritePage(page_id, data);
+          dm.ReadPage(page_id, buf);
+          ASSERT_EQ(std::memcmp(buf, data, PAGE_SIZE), 0);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  dm.ShutDown();
+}
+
+}  // namespace bustub
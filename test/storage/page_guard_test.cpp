@@ -0,0 +1,149 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/storage/page_guard_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/page_guard.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  Page *page;
+  {
+    BasicPageGuard guard = bpm->NewPageGuarded(&page_id);
+    ASSERT_TRUE(guard);
+    page = guard.GetPage();
+    EXPECT_EQ(page_id, guard.PageId());
+    EXPECT_EQ(1, page->GetPinCount());
+
+    // Scenario: moving a guard hands over the pin; the moved-from guard releases nothing.
+    BasicPageGuard moved = std::move(guard);
+    EXPECT_FALSE(guard);  // NOLINT
+    EXPECT_EQ(1, page->GetPinCount());
+    snprintf(moved.GetDataMut(), PAGE_SIZE, "Hello");
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_TRUE(page->IsDirty());
+  ASSERT_TRUE(bpm->FlushPage(page_id));
+  EXPECT_FALSE(page->IsDirty());
+
+  {
+    // Scenario: read guards share the page latch, and only pin the page while they live.
+    ReadPageGuard guard1 = bpm->FetchPageRead(page_id);
+    ReadPageGuard guard2 = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(2, page->GetPinCount());
+    EXPECT_EQ(0, strcmp(guard1.GetData(), "Hello"));
+    guard1.Drop();
+    EXPECT_FALSE(guard1);
+    EXPECT_EQ(1, page->GetPinCount());
+    guard1.Drop();
+    EXPECT_EQ(1, page->GetPinCount());
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_FALSE(page->IsDirty());
+
+  {
+    // Scenario: a write guard releases its latch when it is assigned another page, so the page can be latched again.
+    WritePageGuard guard = bpm->FetchPageWrite(page_id);
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "World");
+    page_id_t other_page_id;
+    guard = WritePageGuard(bpm, bpm->NewPage(&other_page_id));
+    EXPECT_EQ(other_page_id, guard.PageId());
+    EXPECT_EQ(0, page->GetPinCount());
+    EXPECT_TRUE(page->IsDirty());
+    WritePageGuard again = bpm->FetchPageWrite(page_id);
+    EXPECT_EQ(0, strcmp(again.GetData(), "World"));
+  }
+
+  {
+    // Scenario: upgrading a basic guard latches the page and hands over the pin and the dirty flag.
+    BasicPageGuard guard = bpm->FetchPageBasic(page_id);
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "Again");
+    WritePageGuard write_guard = guard.UpgradeWrite();
+    EXPECT_FALSE(guard);  // NOLINT
+    EXPECT_EQ(1, page->GetPinCount());
+    write_guard.Drop();
+    EXPECT_TRUE(page->IsDirty());
+    ReadPageGuard read_guard = bpm->FetchPageBasic(page_id).UpgradeRead();
+    EXPECT_EQ(0, strcmp(read_guard.GetData(), "Again"));
+    EXPECT_EQ(1, page->GetPinCount());
+  }
+
+  // Scenario: pages whose guards are gone can be evicted.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t new_page_id;
+    EXPECT_TRUE(bpm->NewPageGuarded(&new_page_id));
+  }
+  {
+    ReadPageGuard guard = bpm->FetchPageRead(page_id);
+    ASSERT_TRUE(guard);
+    EXPECT_EQ(0, strcmp(guard.GetData(), "Again"));
+  }
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, ParallelBufferPoolTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 3;
+  const size_t pool_size = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size, disk_manager);
+
+  // Scenario: guards unpin through the instance that owns the page, so every frame can be reused afterwards.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < num_instances * pool_size; ++i) {
+    page_id_t page_id;
+    WritePageGuard guard(bpm, bpm->NewPage(&page_id));
+    ASSERT_TRUE(guard);
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  for (int round = 0; round < 2; ++round) {
+    for (page_id_t page_id : page_ids) {
+      ReadPageGuard guard = bpm->FetchPageRead(page_id);
+      ASSERT_TRUE(guard);
+      EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+      EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+    }
+  }
+  page_id_t page_id;
+  EXPECT_TRUE(bpm->NewPageGuarded(&page_id));
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
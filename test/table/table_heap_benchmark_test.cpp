@@ -0,0 +1,208 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_heap_benchmark_test.cpp
+//
+// Identification: test/table/table_heap_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+// Scan benchmarks for the table heap. They are disabled by default because their numbers only mean something on an
+// otherwise idle machine; run them with
+//   ./test/table_heap_benchmark_test --gtest_also_run_disabled_tests
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/mmap_buffer_pool_manager.h"
+#include "concurrency/lock_manager.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "storage/disk/compressed_disk_manager.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+/** A buffer pool that ignores read-ahead hints, i.e. one page per blocking read. */
+class NoPrefetchBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+
+  void PrefetchPages(const std::vector<page_id_t> &page_ids) override {}
+
+  void PrefetchChain(page_id_t page_id, size_t num_pages, next_page_fn next_page) override {}
+};
+
+/**
+ * Fill a new table with num_tuples copies of one tuple and write it to disk.
+ * @return the id of the first page of the table
+ */
+auto BuildTable(DiskManager *disk_manager, LockManager *lock_manager, int num_tuples) -> page_id_t {
+  // InsertTuple walks the page chain from the first page, so the table is built with a pool that holds all of it.
+  const size_t build_pool_size = 1024;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  BufferPoolManagerInstance bpm(build_pool_size, disk_manager);
+  Transaction txn(0);
+  TableHeap table(&bpm, lock_manager, nullptr, &txn);
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    EXPECT_TRUE(table.InsertTuple(tuple, &rid, &txn));
+  }
+  bpm.FlushAllPages();
+  return table.GetFirstPageId();
+}
+
+// NOLINTNEXTLINE
+TEST(TableHeapBenchmarkTest, DISABLED_ColdScanTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 32;
+  const int num_tuples = 40000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *lock_manager = new LockManager();
+  page_id_t first_page_id = BuildTable(disk_manager, lock_manager, num_tuples);
+
+  // Run with builds of different BUSTUB_PAGE_SIZE to compare page sizes: the table holds the same tuples either way.
+  std::cout << "page size " << PAGE_SIZE << std::endl;
+  std::cout << std::setw(12) << "read-ahead" << std::setw(12) << "pages" << std::setw(16) << "pages/sec"
+            << std::setw(16) << "tuples/sec" << std::endl;
+  for (bool read_ahead : {false, true}) {
+    // A fresh buffer pool and an evicted OS page cache, so that every page of the table has to come from the device.
+    int fd = open(db_name.c_str(), O_RDONLY);
+    ASSERT_NE(-1, fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    BufferPoolManagerInstance *bpm = read_ahead ? new BufferPoolManagerInstance(buffer_pool_size, disk_manager)
+                                                : new NoPrefetchBufferPoolManager(buffer_pool_size, disk_manager);
+    Transaction txn(1);
+    TableHeap table(bpm, lock_manager, nullptr, first_page_id);
+    int reads = disk_manager->GetNumReads();
+    int tuples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto iter = table.Begin(&txn); iter != table.End(); ++iter) {
+      tuples++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_tuples, tuples);
+
+    int pages = disk_manager->GetNumReads() - reads;
+    std::cout << std::setw(12) << (read_ahead ? "on" : "off") << std::setw(12) << pages << std::setw(16) << std::fixed
+              << std::setprecision(0) << pages / seconds << std::setw(16) << tuples / seconds << std::endl;
+    delete bpm;
+  }
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bench.log");
+  delete lock_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TableHeapBenchmarkTest, DISABLED_MmapScanTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 32;
+  const int num_tuples = 40000;
+  const int num_scans = 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *lock_manager = new LockManager();
+  page_id_t first_page_id = BuildTable(disk_manager, lock_manager, num_tuples);
+
+  // The table is in the OS page cache for both runs, so the difference is the copy into frame memory (plus the
+  // eviction work of a pool smaller than the table).
+  std::cout << std::setw(12) << "buffer pool" << std::setw(16) << "tuples/sec" << std::endl;
+  for (bool mmap : {false, true}) {
+    BufferPoolManager *bpm = mmap ? static_cast<BufferPoolManager *>(new MmapBufferPoolManager(disk_manager))
+                                  : new NoPrefetchBufferPoolManager(buffer_pool_size, disk_manager);
+    Transaction txn(1);
+    TableHeap table(bpm, lock_manager, nullptr, first_page_id);
+    int tuples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_scans; ++i) {
+      for (auto iter = table.Begin(&txn); iter != table.End(); ++iter) {
+        tuples++;
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_scans * num_tuples, tuples);
+
+    std::cout << std::setw(12) << (mmap ? "mmap" : "copy") << std::setw(16) << std::fixed << std::setprecision(0)
+              << tuples / seconds << std::endl;
+    delete bpm;
+  }
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bench.log");
+  delete lock_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TableHeapBenchmarkTest, DISABLED_CompressedScanTest) {
+  const std::string db_name = "bench.db";
+  const size_t buffer_pool_size = 32;
+  const int num_tuples = 40000;
+
+  // Every row of the table is the same tuple and the last page is partly empty, so this is close to the best case for
+  // compression; the scan rate shows what decompression costs against the smaller reads.
+  std::cout << std::setw(12) << "disk" << std::setw(16) << "file bytes" << std::setw(12) << "ratio" << std::setw(16)
+            << "tuples/sec" << std::endl;
+  off_t plain_size = 0;
+  for (bool compressed : {false, true}) {
+    DiskManager *disk_manager = compressed ? new CompressedDiskManager(db_name) : new DiskManager(db_name);
+    auto *lock_manager = new LockManager();
+    page_id_t first_page_id = BuildTable(disk_manager, lock_manager, num_tuples);
+
+    int fd = open(db_name.c_str(), O_RDONLY);
+    ASSERT_NE(-1, fd);
+    struct stat stat_buf;
+    ASSERT_EQ(0, fstat(fd, &stat_buf));
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    if (!compressed) {
+      plain_size = stat_buf.st_size;
+    }
+
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+    Transaction txn(1);
+    TableHeap table(bpm, lock_manager, nullptr, first_page_id);
+    int tuples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto iter = table.Begin(&txn); iter != table.End(); ++iter) {
+      tuples++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_tuples, tuples);
+
+    std::cout << std::setw(12) << (compressed ? "lz4" : "plain") << std::setw(16) << stat_buf.st_size << std::setw(12)
+              << std::fixed << std::setprecision(2) << static_cast<double>(plain_size) / stat_buf.st_size
+              << std::setw(16) << std::setprecision(0) << tuples / seconds << std::endl;
+    delete bpm;
+    disk_manager->ShutDown();
+    remove(db_name.c_str());
+    remove("bench.log");
+    delete lock_manager;
+    delete disk_manager;
+  }
+}
+
+}  // namespace bustub